@@ -13,25 +13,77 @@
  */
 
 #include "EADOG.h"
+#include "EADOGTranspose.h"
 #include "mbed.h"
 #include "stdio.h"
 #include "Small_7.h"
 
+#if !EADOG_NO_HEAP
 EADOG::EADOG(PinName mosi, PinName sck, PinName reset, PinName a0, PinName cs, uint8_t type) : _spi(mosi, NC, sck), _reset(reset), _a0(a0), _cs(cs), _type(type), graphic_buffer() {
+  geometry();
+  graphic_buffer = new uint8_t [graphic_buffer_size * (1 + EADOG_SHADOW)];
+#if EADOG_SHADOW
+  shadow_buffer = graphic_buffer + graphic_buffer_size; // second frame of the buffer
+#endif
+  own_buffer = true;
+  band_pages = height / 8;
+  init();
+  }
+#endif
+
+EADOG::EADOG(PinName mosi, PinName sck, PinName reset, PinName a0, PinName cs, uint8_t type, uint8_t *buffer, uint8_t pages) : _spi(mosi, NC, sck), _reset(reset), _a0(a0), _cs(cs), _type(type), graphic_buffer(buffer) {
+  geometry();
+  band_pages = (pages == 0 || pages > height / 8) ? height / 8 : pages;
+#if EADOG_SHADOW
+  shadow_buffer = banded() ? NULL : buffer + graphic_buffer_size; // second frame of the buffer
+#endif
+  own_buffer = false;
+  init();
+  }
+
+EADOG::~EADOG() {
+  sync();                              // no DMA into a released buffer
+#if !EADOG_NO_HEAP
+  if (own_buffer) delete [] graphic_buffer;
+#endif
+  }
+
+#ifdef EADOG_FIXED_TYPE
+const uint8_t EADOG::width;
+const uint8_t EADOG::height;
+const uint32_t EADOG::graphic_buffer_size;
+#endif
+
+// set the size of the display type and clear the state
+void EADOG::geometry() {
+#ifdef EADOG_FIXED_TYPE
+  if ((_type == DOGM132) != (EADOG_FIXED_TYPE == DOGM132)) { // geometry of another type is compiled in
+    error("EADOG: display type %d differs from EADOG_FIXED_TYPE\r\n", _type); // halts in every build profile, the buffer would overflow
+    }
+#else
   if (_type == DOGM132) {
-    width = 132;
-    height = 32;
-    graphic_buffer_size = 528;
-    graphic_buffer = new uint8_t [graphic_buffer_size];
+    width = EADOGGeometry<DOGM132>::width;
+    height = EADOGGeometry<DOGM132>::height;
+    graphic_buffer_size = EADOGGeometry<DOGM132>::size;
     }
-
-  if (_type == DOGM128 || _type == DOGL128) {
-    width = 128;
-    height = 64;
-    graphic_buffer_size = 1024;
-    graphic_buffer = new uint8_t [graphic_buffer_size];
+  else {                               // DOGM128, DOGL128 and unknown types
+    width = EADOGGeometry<DOGM128>::width;
+    height = EADOGGeometry<DOGM128>::height;
+    graphic_buffer_size = EADOGGeometry<DOGM128>::size;
     }
-    init();
+#endif
+  band_page = 0;
+  rendering = false;
+  memset(dirty_min, 0xFF, sizeof(dirty_min));
+  memset(dirty_max, 0x00, sizeof(dirty_max));
+#if DEVICE_SPI_ASYNCH
+  async_busy = false;
+  async_queued = false;
+  async_done_count = 0;
+  async_queue_count = 0;
+  memset(async_queue_first, 0xFF, sizeof(async_queue_first));
+  memset(async_queue_last, 0x00, sizeof(async_queue_last));
+#endif
   }
 
 static void inline swap(int &a, int &b) {
@@ -41,6 +93,7 @@ static void inline swap(int &a, int &b) {
   }
 
 void EADOG::display(uint8_t display) {
+  bus_mutex.lock();                    // command pairs are not split by another thread
   if (display == ON) { // display on
     write_command(0xA4);
     write_command(0xAF);
@@ -62,11 +115,13 @@ void EADOG::display(uint8_t display) {
   if (display == TOPVIEW) { // reverse orientation
     write_command(0xA0); // ADC normal
     write_command(0xC8); // reversed com31-com0
+    invalidate();
     update(); // update necessary
       }
   if (display == BOTTOM) { // normal orientation
     write_command(0xA1); // ADC reverse
     write_command(0xC0); // normal com0-com31
+    invalidate();
     update(); // update necessary
     }
   if (display == CONTRAST) {
@@ -83,31 +138,69 @@ void EADOG::display(uint8_t display) {
       write_command(0x10);
       }
     }
+  bus_mutex.unlock();
   }
 
 void EADOG::display(uint8_t display, uint8_t value) {
   if (display == CONTRAST) {
     if (value < 64) {
+      bus_mutex.lock();
       write_command(0x81); //  set contrast
       write_command(value & 0x3F);
+      bus_mutex.unlock();
       }
     }
   }
 
 // write command to lcd controller
 void EADOG::write_command(uint8_t command) {
+  bus_mutex.lock();
+  sync();
   _a0 = 0;
   _cs = 0;
   _spi.write(command);
   _cs = 1;
+  bus_mutex.unlock();
+  }
+
+// write a block of commands to lcd controller with one chip select
+void EADOG::write_command(const uint8_t *command, int length) {
+  bus_mutex.lock();
+  sync();
+  _a0 = 0;
+  _cs = 0;
+  _spi.write((const char*)command, length, NULL, 0);
+  _cs = 1;
+  bus_mutex.unlock();
   }
 
 // write data to lcd controller
 void EADOG::write_data(uint8_t data) {
+  bus_mutex.lock();
+  sync();
   _a0 = 1;
   _cs = 0;
   _spi.write(data);
   _cs = 1;
+  bus_mutex.unlock();
+  }
+
+// write a block of data to lcd controller with one chip select
+void EADOG::write_data(const uint8_t *data, int length) {
+  bus_mutex.lock();
+  sync();
+  _a0 = 1;
+  _cs = 0;
+  _spi.write((const char*)data, length, NULL, 0);
+  _cs = 1;
+  bus_mutex.unlock();
+  }
+
+// wait for a running background update, the bus is not shared
+void EADOG::sync() {
+#if DEVICE_SPI_ASYNCH
+  while (async_busy);
+#endif
   }
 
 // reset and init the lcd controller
@@ -152,165 +245,616 @@ void EADOG::init() {
   write_command(0xAF); // display on
 
   // clear and update LCD
-  cls();
-  auto_update = 1;              // switch on auto update
+  clip();                       // draw on the whole display
+  memset(graphic_buffer, 0x00, band_pages * width); // the shadow is built from the cleared frame
+  invalidate();                 // controller RAM is undefined after reset
+  if (banded()) render(Callback<void()>()); // stream empty bands
+  else update();
+  auto_update = AUTO;           // switch on auto update
+  refresh_scheduled = false;
+  batch_depth = 0;
+  refresh_interval = 1000 / 25; // max 25 frames per second in DEFERRED mode
+  refresh_queue = NULL;
   locate(0, 0);
   font((unsigned char*)Small_7);  // standard font
   }
 
-// update lcd
+// update lcd, only the dirty columns of dirty pages are sent
 void EADOG::update() {
-  //page 0
-  write_command(0x00);      // set column low nibble 0
-  write_command(0x10);      // set column hi  nibble 0
-  write_command(0xB0);      // set page address  0
-  _a0 = 1;
+  uint8_t first[8], last[8];
 
-  for (int i = 0; i < width; i++) {
-    write_data(graphic_buffer[i]);
+  if (banded()) return;                // render() sends the bands
+  sync();
+  memset(first, 0xFF, sizeof(first));
+  memset(last, 0x00, sizeof(last));
+  take_dirty(first, last);
+  for (int page = 0; page < height / 8; page++) {
+    if (first[page] <= last[page]) send(page, first[page], last[page]);
     }
+  }
 
-  // page 1
-  write_command(0x00);      // set column low nibble 0
-  write_command(0x10);      // set column hi  nibble 0
-  write_command(0xB1);      // set page address  1
-  _a0 = 1;
+// update a window of the lcd, rounded to pages
+void EADOG::update(int x0, int y0, int x1, int y1) {
+  if (x0 > x1) swap(x0, x1);
+  if (y0 > y1) swap(y0, y1);
+  if (x0 < 0) x0 = 0;
+  if (y0 < 0) y0 = 0;
+  if (x1 > width - 1) x1 = width - 1;
+  if (y1 > height - 1) y1 = height - 1;
+  if (x0 > x1 || y0 > y1 || banded()) return; // outside the display
+  sync();
+  for (int page = y0 / 8; page <= y1 / 8; page++) {
+    send(page, x0, x1);
+    }
+  }
 
-  for (int i = width; i < width * 2; i++) {
-    write_data(graphic_buffer[i]);
+// send columns first to last of a page, address and data are not split by another thread
+void EADOG::send(uint8_t page, uint8_t first, uint8_t last) {
+  uint8_t commands[3];
+  uint8_t *data = buffer(0, page);
+
+  bus_mutex.lock();
+#if EADOG_SHADOW
+  if (shadow_buffer) {
+    send_changes(page, first, last);
+    bus_mutex.unlock();
+    return;
     }
+#endif
+  address(commands, page, first);
+  write_command(commands, 3);
+  write_data(&data[first], last - first + 1); // burst the span
+  bus_mutex.unlock();
+  }
 
-  //page 2
-  write_command(0x00);      // set column low nibble 0
-  write_command(0x10);      // set column hi  nibble 0
-  write_command(0xB2);      // set page address  2
-  _a0 = 1;
+#if EADOG_SHADOW
+// only runs of bytes that differ from the shadow buffer are sent,
+// unchanged gaps shorter than a new column address are sent through
+void EADOG::send_changes(uint8_t page, uint8_t first, uint8_t last) {
+  uint8_t *data = &graphic_buffer[page * width];
+  uint8_t *shadow = &shadow_buffer[page * width];
+  uint8_t commands[3];
+  int column = -1;                       // controller column, page not addressed yet
+  int x = first;
 
-  for (int i = width * 2; i < width * 3; i++) {
-    write_data(graphic_buffer[i]);
+  while (1) {
+    while (x <= last && data[x] == shadow[x]) x++; // skip unchanged bytes
+    if (x > last) break;
+    int end = x;
+    for (int i = x + 1; i <= last && i - end <= EADOG_READDRESS_COST; i++) {
+      if (data[i] != shadow[i]) end = i; // extend run through short gaps
+      }
+    int n = 0;
+    if (column < 0) {
+      address(commands, page, x);
+      n = 3;
+      }
+    else {                               // same page, smallest column preamble
+      if ((column >> 4) != (x >> 4)) commands[n++] = 0x10 | (x >> 4);
+      if ((column & 0x0F) != (x & 0x0F)) commands[n++] = 0x00 | (x & 0x0F);
+      }
+    write_command(commands, n);
+    write_data(&data[x], end - x + 1);
+    memcpy(&shadow[x], &data[x], end - x + 1);
+    column = end + 1;
+    x = end + 1;
     }
+  }
+#endif
 
-  //page 3
-  write_command(0x00);      // set column low nibble 0
-  write_command(0x10);      // set column hi  nibble 0
-  write_command(0xB3);      // set page address  3
-  _a0 = 1;
+// mark the whole frame for the next update, the controller RAM content is unknown
+void EADOG::invalidate() {
+#if EADOG_SHADOW
+  for (uint32_t i = 0; shadow_buffer && i < graphic_buffer_size; i++) {
+    shadow_buffer[i] = ~graphic_buffer[i];  // every byte differs
+    }
+#endif
+  dirty(0, 0, width - 1, height - 1);
+  }
+
+// build the page and column address commands
+void EADOG::address(uint8_t *commands, uint8_t page, uint8_t column) {
+  commands[0] = 0xB0 | page;             // set page address
+  commands[1] = 0x10 | (column >> 4);    // set column hi  nibble
+  commands[2] = 0x00 | (column & 0x0F);  // set column low nibble
+  }
 
-  for (int i = width * 3; i < width * 4; i++) {
-    write_data(graphic_buffer[i]);
+// mark a rectangle of the buffer for the next update, limited to the display
+void EADOG::dirty(int x0, int y0, int x1, int y1) {
+  if (x0 < 0) x0 = 0;
+  if (y0 < 0) y0 = 0;
+  if (x1 > width - 1) x1 = width - 1;
+  if (y1 > height - 1) y1 = height - 1;
+  for (int page = y0 / 8; page <= y1 / 8; page++) {
+    if (x0 < dirty_min[page] || x1 > dirty_max[page]) dirty_span(page, x0, x1);
     }
+  }
 
-  if (_type == DOGM128 || _type == DOGL128) {
-    //page 4
-    write_command(0x00);      // set column low nibble 0
-    write_command(0x10);      // set column hi  nibble 0
-    write_command(0xB4);      // set page address  3
-    _a0 = 1;
+void EADOG::dirty_span(int page, int x0, int x1) {
+  core_util_critical_section_enter();  // DEFERRED and async updates take the spans from other contexts
+  if (x0 < dirty_min[page]) dirty_min[page] = x0;
+  if (x1 > dirty_max[page]) dirty_max[page] = x1;
+  core_util_critical_section_exit();
+  }
 
-    for (int i = width * 4; i < width * 5; i++) {
-      write_data(graphic_buffer[i]);
-      }
+// merge the dirty spans into first / last and clear them
+void EADOG::take_dirty(uint8_t *first, uint8_t *last) {
+  core_util_critical_section_enter();
+  for (int page = 0; page < height / 8; page++) {
+    if (dirty_min[page] < first[page]) first[page] = dirty_min[page];
+    if (dirty_max[page] > last[page]) last[page] = dirty_max[page];
+    dirty_min[page] = 0xFF;
+    dirty_max[page] = 0x00;
+    }
+  core_util_critical_section_exit();
+  }
 
-    //page 5
-    write_command(0x00);      // set column low nibble 0
-    write_command(0x10);      // set column hi  nibble 0
-    write_command(0xB5);      // set page address  3
-    _a0 = 1;
+#if DEVICE_SPI_ASYNCH
+// update lcd in background, a running transfer queues the next one,
+// the callbacks of all requests in a queued transfer are kept
+bool EADOG::update_async(Callback<void()> done) {
+  bool kept = true;
 
-    for (int i = width * 5; i < width * 6; i++) {
-      write_data(graphic_buffer[i]);
-      }
+  if (banded()) {                      // render() sends the bands
+    if (done) done();
+    return true;
+    }
+  core_util_critical_section_enter();
+  take_dirty(async_queue_first, async_queue_last); // the interrupt never touches the live dirty spans
+  if (done) {
+    if (async_queue_count < EADOG_ASYNC_CALLBACKS) async_queue_done[async_queue_count++] = done;
+    else kept = false;
+    }
+  if (async_busy) {                    // no lock, also called from the callbacks
+    async_queued = true;
+    core_util_critical_section_exit();
+    return kept;
+    }
+  core_util_critical_section_exit();
+  bus_mutex.lock();                    // a write of another thread ends first
+  core_util_critical_section_enter();
+  if (async_busy) {                    // started meanwhile
+    async_queued = true;
+    core_util_critical_section_exit();
+    bus_mutex.unlock();
+    return kept;
+    }
+  async_busy = true;
+  core_util_critical_section_exit();
+  async_start();
+  bus_mutex.unlock();
+  return kept;
+  }
 
-    //page 6
-    write_command(0x00);      // set column low nibble 0
-    write_command(0x10);      // set column hi  nibble 0
-    write_command(0xB6);      // set page address  3
-    _a0 = 1;
+bool EADOG::busy() {
+  return async_busy;
+  }
 
-    for (int i = width * 6; i < width *7; i++) {
-      write_data(graphic_buffer[i]);
-      }
+// move the queued dirty spans and callbacks in flight and start with the first page
+void EADOG::async_start() {
+  core_util_critical_section_enter();
+  memcpy(async_first, async_queue_first, sizeof(async_first));
+  memcpy(async_last, async_queue_last, sizeof(async_last));
+  memset(async_queue_first, 0xFF, sizeof(async_queue_first));
+  memset(async_queue_last, 0x00, sizeof(async_queue_last));
+  for (int i = 0; i < async_queue_count; i++) async_done[i] = async_queue_done[i];
+  async_done_count = async_queue_count;
+  async_queue_count = 0;
+  core_util_critical_section_exit();
+  async_page = 0;
+  async_data = false;
+  async_next();
+  }
 
-    //page 7
-    write_command(0x00);      // set column low nibble 0
-    write_command(0x10);      // set column hi  nibble 0
-    write_command(0xB7);      // set page address  3
-    _a0 = 1;
+// skip clean pages, start the next transfer or finish
+void EADOG::async_next() {
+  while (async_page < height / 8 && async_first[async_page] > async_last[async_page]) async_page++;
+  if (async_page < height / 8) {
+    async_transfer();
+    return;
+    }
+  async_finish();
+  core_util_critical_section_enter();
+  bool queued = async_queued;
+  async_queued = false;
+  if (!queued) async_busy = false;
+  core_util_critical_section_exit();
+  if (queued) async_start();           // coalesced request, send what changed meanwhile
+  }
 
-    for (int i = width * 7; i < width *8; i++) {
-      write_data(graphic_buffer[i]);
+// a failed transfer ends the chain, the unsent spans are dirty again for the next update
+void EADOG::async_abort() {
+  _cs = 1;
+  core_util_critical_section_enter();
+#if EADOG_SHADOW
+  if (async_data) {                      // the shadow already holds the failed span
+    for (int x = async_first[async_page]; x <= async_last[async_page]; x++) {
+      shadow_buffer[async_page * width + x] = ~graphic_buffer[async_page * width + x];
+      }
+    }
+#endif
+  for (int page = 0; page < height / 8; page++) {
+    if (page >= async_page && async_first[page] <= async_last[page]) {
+      if (async_first[page] < dirty_min[page]) dirty_min[page] = async_first[page];
+      if (async_last[page] > dirty_max[page]) dirty_max[page] = async_last[page];
+      }
+    if (async_queue_first[page] <= async_queue_last[page]) {
+      if (async_queue_first[page] < dirty_min[page]) dirty_min[page] = async_queue_first[page];
+      if (async_queue_last[page] > dirty_max[page]) dirty_max[page] = async_queue_last[page];
       }
     }
+  memset(async_queue_first, 0xFF, sizeof(async_queue_first));
+  memset(async_queue_last, 0x00, sizeof(async_queue_last));
+  Callback<void()> queued[EADOG_ASYNC_CALLBACKS]; // the queued requests end too
+  int count = async_queue_count;
+  for (int i = 0; i < count; i++) queued[i] = async_queue_done[i];
+  async_queue_count = 0;
+  async_queued = false;
+  core_util_critical_section_exit();
+  async_finish();
+  for (int i = 0; i < count; i++) queued[i](); // busy yet, new requests of the callbacks are queued
+  core_util_critical_section_enter();
+  bool again = async_queued;
+  async_queued = false;
+  if (!again) async_busy = false;
+  core_util_critical_section_exit();
+  if (again) async_start();            // requested by a callback
+  }
 
-  _cs = 0;
+// call the callbacks of the finished transfer, their requests are queued
+void EADOG::async_finish() {
+  int count = async_done_count;
+  async_done_count = 0;
+  for (int i = 0; i < count; i++) async_done[i]();
+  }
+
+// start commands or data of the actual page
+void EADOG::async_transfer() {
+  uint8_t first = async_first[async_page];
+  int result;
+  if (async_data) {
+#if EADOG_SHADOW
+    memcpy(&shadow_buffer[async_page * width + first], &graphic_buffer[async_page * width + first], async_last[async_page] - first + 1);
+#endif
+    _a0 = 1;
+    _cs = 0;
+    result = _spi.transfer(&graphic_buffer[async_page * width + first], async_last[async_page] - first + 1, (uint8_t*)NULL, 0, callback(this, &EADOG::async_event), SPI_EVENT_COMPLETE | SPI_EVENT_ERROR);
+    }
+  else {
+    address(async_commands, async_page, first);
+    _a0 = 0;
+    _cs = 0;
+    result = _spi.transfer(async_commands, 3, (uint8_t*)NULL, 0, callback(this, &EADOG::async_event), SPI_EVENT_COMPLETE | SPI_EVENT_ERROR);
+    }
+  if (result != 0) async_abort();        // transfer not started
+  }
 
+// interrupt context, chain the next transfer
+void EADOG::async_event(int event) {
+  _cs = 1;
+  if ((event & SPI_EVENT_ERROR) || !(event & SPI_EVENT_COMPLETE)) {
+    async_abort();
+    return;
+    }
+  if (async_data) {
+    async_data = false;
+    async_page++;
+    async_next();
+    }
+  else {
+    async_data = true;
+    async_transfer();
+    }
   }
+#endif
+
 void EADOG::update(uint8_t mode) {
-  if (mode == MANUAL) auto_update = 0;
-  if (mode == AUTO) auto_update = 1;
+  if (mode == MANUAL) auto_update = MANUAL;
+  if (mode == AUTO) auto_update = AUTO;
+  if (mode == DEFERRED) auto_update = DEFERRED;
+  }
+
+void EADOG::framerate(uint8_t fps, EventQueue *queue) {
+  if (fps == 0) fps = 1;
+  refresh_interval = 1000 / fps;
+  if (queue) refresh_queue = queue;
+  }
+
+EADOG::Batch::Batch(EADOG &lcd) : _lcd(lcd) {
+  _lcd.batch_begin();
+  }
+
+EADOG::Batch::~Batch() {
+  _lcd.batch_end();
+  }
+
+void EADOG::batch_begin() {
+  batch_depth++;
+  }
+
+// the outermost batch updates once
+void EADOG::batch_end() {
+  if (batch_depth > 0 && --batch_depth == 0) refresh();
+  }
+
+// update after drawing, depending on the update mode
+void EADOG::refresh() {
+  if (batch_depth || banded()) return; // inside a batch, done at its end
+  if (auto_update == AUTO) update();
+  if (auto_update == DEFERRED && !refresh_scheduled) {
+    if (!refresh_queue) refresh_queue = mbed_event_queue();
+    refresh_scheduled = true;          // following drawing collapses into this update
+    if (!refresh_queue->call_in(refresh_interval, callback(this, &EADOG::deferred_update))) {
+      refresh_scheduled = false;       // queue full, send now instead of never
+      update();
+      }
+    }
+  }
+
+// event queue context, update once for all drawing since the last frame
+void EADOG::deferred_update() {
+  refresh_scheduled = false;
+  update();
   }
 
 // clear screen
 void EADOG::cls() {
+  if (banded()) {
+    render(Callback<void()>());        // stream empty bands
+    return;
+    }
   memset(graphic_buffer, 0x00, graphic_buffer_size);  // clear display graphic_buffer
-  update();
+  dirty(0, 0, width - 1, height - 1);
+  refresh();
+  }
+
+// draw the scene once per band and stream each band to the lcd
+void EADOG::render(Callback<void()> draw) {
+  if (!banded()) {
+    {
+      Batch batch(*this);              // one update for the scene
+      memset(graphic_buffer, 0x00, graphic_buffer_size);
+      dirty(0, 0, width - 1, height - 1);
+      if (draw) draw();
+      }
+    if (batch_depth == 0) update();    // also in MANUAL and DEFERRED mode, an outer batch sends it at its end
+    return;
+    }
+  rendering = true;
+  for (int page = 0; page < height / 8; page += band_pages) {
+    band_page = page;
+    memset(graphic_buffer, 0x00, band_pages * width);
+    clip_band();                       // also clip() inside draw stays in the band
+    if (draw && clip_y0 <= clip_y1) draw();
+    for (int p = page; p < page + band_pages && p < height / 8; p++) {
+      send(p, 0, width - 1);
+      }
+    }
+  band_page = 0;
+  rendering = false;
+  clip_band();
+  }
+
+bool EADOG::banded() {
+  return band_pages < height / 8;
   }
 
 // set one pixel in graphic_buffer
 void EADOG::pixel(int x, int y, uint8_t color) {
-  if (x > width - 1 || y > height - 1 || x < 0 || y < 0) return;
-  if (color == 0) graphic_buffer[x + ((y / 8) * width)] &= ~(1 << (y % 8)); // erase pixel
-  else graphic_buffer[x + ((y / 8) * width)] |= (1 << (y % 8));   // set pixel
+  if (x > clip_x1 || y > clip_y1 || x < clip_x0 || y < clip_y0) return;
+  int page = y >> 3;                                            // y is not negative here
+  if (color == 0) *buffer(x, page) &= ~(1 << (y & 0x07)); // erase pixel
+  else *buffer(x, page) |= (1 << (y & 0x07));   // set pixel
+  if (x < dirty_min[page] || x > dirty_max[page]) dirty_span(page, x, x); // track changed columns, locked only when the span grows
   }
 
 void EADOG::point(int x, int y, uint8_t colour) {
   pixel(x, y, colour);
-  if (auto_update) update();
+  refresh();
+  }
+
+// restrict drawing to a rect inside the display
+void EADOG::clip(int x0, int y0, int x1, int y1) {
+  if (x0 > x1) swap(x0, x1);
+  if (y0 > y1) swap(y0, y1);
+  view_x0 = x0 < 0 ? 0 : x0;
+  view_y0 = y0 < 0 ? 0 : y0;
+  view_x1 = x1 > width - 1 ? width - 1 : x1;
+  view_y1 = y1 > height - 1 ? height - 1 : y1;
+  clip_band();
+  }
+
+void EADOG::clip_band() {
+  clip_x0 = view_x0;
+  clip_y0 = view_y0;
+  clip_x1 = view_x1;
+  clip_y1 = view_y1;
+  if (!banded()) return;
+  if (!rendering) {                    // no band in the buffer, draw nothing
+    clip_x0 = clip_y0 = 0;
+    clip_x1 = clip_y1 = -1;
+    return;
+    }
+  if (clip_y0 < band_page * 8) clip_y0 = band_page * 8; // drawing stays inside the band
+  if (clip_y1 > (band_page + band_pages) * 8 - 1) clip_y1 = (band_page + band_pages) * 8 - 1;
+  }
+
+void EADOG::clip() {
+  clip(0, 0, width - 1, height - 1);
+  }
+
+// Cohen-Sutherland region code of a point against the clip rect
+uint8_t EADOG::outcode(int x, int y) {
+  uint8_t code = 0;
+  if (x < clip_x0) code |= 0x01;
+  else if (x > clip_x1) code |= 0x02;
+  if (y < clip_y0) code |= 0x04;
+  else if (y > clip_y1) code |= 0x08;
+  return code;
+  }
+
+// limit the major steps i to those where the minor offset
+// q(i) = (2 * i * d + D) / (2 * D) stays within kmin .. kmax
+static void clip_steps(int D, int d, int kmin, int kmax, int &imin, int &imax) {
+  if (kmax < 0) {
+    imax = imin - 1;
+    return;
+    }
+  if (kmin > 0) {
+    int64_t i = ((int64_t)2 * D * kmin - D + 2 * d - 1) / (2 * d);  // first step with q(i) >= kmin
+    if (i > imin) imin = i > imax ? imax + 1 : (int)i;
+    }
+  int64_t i = ((int64_t)2 * D * (kmax + 1) - D - 1) / (2 * d);      // last step with q(i) <= kmax
+  if (i < imax) imax = (int)i;
   }
 
 // This function uses Bresenham's algorithm to draw a straight line.
+// The line is clipped once, the visible steps start with the error term
+// of the whole line, so the pixels are the same as unclipped.
 void EADOG::line(int x0, int y0, int x1, int y1, uint8_t colour) {
-  int dx =  abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
-  int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
-  int err = dx + dy, e2; /* error value e_xy */
+  if (y0 == y1) {                      // axis aligned lines write whole bytes
+    hline(x0, x1, y0, colour);
+    return;
+    }
+  if (x0 == x1) {
+    vline(x0, y0, y1, colour);
+    return;
+    }
+  uint8_t c0 = outcode(x0, y0);
+  uint8_t c1 = outcode(x1, y1);
+  if (c0 & c1) return;                 // both end points outside on the same side
 
-  while(1) {
-    pixel(x0, y0, 1);
-    if (x0 == x1 && y0 == y1) break;
-    e2 = 2 * err;
-    if (e2 > dy) { err += dy; x0 += sx; } /* e_xy+e_x > 0 */
-    if (e2 < dx) { err += dx; y0 += sy; } /* e_xy+e_y < 0 */
+  bool xmajor = abs(x1 - x0) >= abs(y1 - y0);
+  if (xmajor ? x0 > x1 : y0 > y1) {    // walk the major axis upwards
+    swap(x0, x1);
+    swap(y0, y1);
+    }
+  int sx = x0 < x1 ? 1 : -1;
+  int sy = y0 < y1 ? 1 : -1;
+  int D = xmajor ? x1 - x0 : y1 - y0;  // major length
+  int d = xmajor ? abs(y1 - y0) : abs(x1 - x0); // minor length
+  int imin = 0;
+  int imax = D;
+  if (c0 | c1) {                       // clip the steps, no tests in the loop
+    if (xmajor) {
+      if (clip_x0 - x0 > imin) imin = clip_x0 - x0;
+      if (clip_x1 - x0 < imax) imax = clip_x1 - x0;
+      if (sy > 0) clip_steps(D, d, clip_y0 - y0, clip_y1 - y0, imin, imax);
+      else clip_steps(D, d, y0 - clip_y1, y0 - clip_y0, imin, imax);
+      }
+    else {
+      if (clip_y0 - y0 > imin) imin = clip_y0 - y0;
+      if (clip_y1 - y0 < imax) imax = clip_y1 - y0;
+      if (sx > 0) clip_steps(D, d, clip_x0 - x0, clip_x1 - x0, imin, imax);
+      else clip_steps(D, d, x0 - clip_x1, x0 - clip_x0, imin, imax);
+      }
+    if (imin > imax) return;           // line misses the clip rect
     }
-  if (auto_update) update();
+
+  // first and last visible pixel, error term at the first one
+  int64_t t = (int64_t)2 * imin * d + D;
+  int e = t % (2 * D);
+  int q0 = t / (2 * D);
+  int q1 = ((int64_t)2 * imax * d + D) / (2 * D);
+  int xa = xmajor ? x0 + imin : x0 + sx * q0;
+  int ya = xmajor ? y0 + sy * q0 : y0 + imin;
+  int xb = xmajor ? x0 + imax : x0 + sx * q1;
+  int yb = xmajor ? y0 + sy * q1 : y0 + imax;
+
+  uint8_t *p = buffer(xa, ya / 8);
+  uint8_t mask = 1 << (ya & 0x07);
+  int n = imax - imin;
+  while (1) {
+    if (colour) *p |= mask;
+    else *p &= ~mask;
+    if (n-- == 0) break;
+    e += 2 * d;
+    bool minor = e >= 2 * D;
+    if (minor) e -= 2 * D;
+    if (xmajor || minor) p += xmajor ? 1 : sx;  // next column
+    if (!xmajor || minor) {            // next line
+      if (xmajor && sy < 0) {
+        mask >>= 1;
+        if (!mask) {
+          mask = 0x80;
+          p -= width;
+          }
+        }
+      else {
+        mask <<= 1;
+        if (!mask) {
+          mask = 0x01;
+          p += width;
+          }
+        }
+      }
+    }
+  dirty(xa < xb ? xa : xb, ya < yb ? ya : yb, xa < xb ? xb : xa, ya < yb ? yb : ya);
+  refresh();
+  }
+
+// one bit mask across the columns
+void EADOG::hline(int x0, int x1, int y, uint8_t colour) {
+  if (x0 > x1) swap(x0, x1);
+  fill(x0, y, x1, y, colour);
+  refresh();
+  }
+
+// partial and complete page bytes
+void EADOG::vline(int x, int y0, int y1, uint8_t colour) {
+  if (y0 > y1) swap(y0, y1);
+  fill(x, y0, x, y1, colour);
+  refresh();
   }
 
 void EADOG::rectangle(int x0, int y0, int x1, int y1, uint8_t colour) {
-  uint8_t upd = auto_update;
-  auto_update = 0;
+  Batch batch(*this);                    // one update at the end
   line(x0, y0, x1, y0, colour);
   line(x0, y1, x1, y1, colour);
   line(x0, y0, x0, y1, colour);
   line(x1, y0, x1, y1, colour);
-  auto_update = upd;
-  if (auto_update) update();
   }
 
 void EADOG::fillrect(int x0, int y0, int x1, int y1, uint8_t colour) {
   if (x0 > x1) swap(x0, x1);
   if (y0 > y1) swap(y0, y1);
-  for (int i = x0; i <= x1; i++) {
-    for (int j = y0; j <= y1; j++) {
-      pixel(i, j, colour);
+  fill(x0, y0, x1, y1, colour);
+  refresh();
+  }
+
+// fill a sorted rect page by page, whole bytes for covered pages
+void EADOG::fill(int x0, int y0, int x1, int y1, uint8_t colour) {
+  if (x0 < clip_x0) x0 = clip_x0;
+  if (y0 < clip_y0) y0 = clip_y0;
+  if (x1 > clip_x1) x1 = clip_x1;
+  if (y1 > clip_y1) y1 = clip_y1;
+  if (x0 > x1 || y0 > y1) return;     // outside the clip rect
+
+  int first = y0 / 8;
+  int last = y1 / 8;
+  int n = x1 - x0 + 1;
+  for (int page = first; page <= last; page++) {
+    uint8_t mask = 0xFF;
+    if (page == first) mask &= 0xFF << (y0 & 0x07);        // top partial page
+    if (page == last) mask &= 0xFF >> (7 - (y1 & 0x07));   // bottom partial page
+    uint8_t *p = buffer(x0, page);
+    if (mask == 0xFF) {
+      memset(p, colour ? 0xFF : 0x00, n);
+      }
+    else if (colour) {
+      for (int i = 0; i < n; i++) p[i] |= mask;
+      }
+    else {
+      for (int i = 0; i < n; i++) p[i] &= ~mask;
       }
     }
-  if (auto_update) update();
+  dirty(x0, y0, x1, y1);
   }
 
 void EADOG::roundrect(int x0, int y0, int x1, int y1, int rnd, uint8_t colour) {
   if (x0 > x1) swap(x0, x1);
   if (y0 > y1) swap(y0, y1);
-  uint8_t upd = auto_update;
-  auto_update = 0;
+  Batch batch(*this);                    // one update at the end
   int r = rnd;
   int x = -r, y = 0, err = 2 - 2 * r;
   line(x0 + rnd, y0, x1 - rnd, y0, colour);
@@ -326,31 +870,39 @@ void EADOG::roundrect(int x0, int y0, int x1, int y1, int rnd, uint8_t colour) {
     if (r <= y) err += ++y * 2 + 1;
     if (r > x || err > y) err += ++x * 2 + 1;
     } while (x < 0);
-  auto_update = upd;
-  if (auto_update) update();
   }
 
+// middle band as one rect, one span per line for the rounded caps
 void EADOG::fillrrect(int x0, int y0, int x1, int y1, int rnd, uint8_t colour) {
   if (x0 > x1) swap(x0, x1);
   if (y0 > y1) swap(y0, y1);
-  uint8_t upd = auto_update;
-  auto_update = 0;
-  int r = rnd;
-  int x = -r, y = 0, err = 2 - 2 * r;
-  for (int i = x0; i <= x1; i++) {
-    for (int j = y0+rnd; j <= y1-rnd; j++) {
-      pixel(i, j, colour);
-      }
-    }
+  if (rnd > (x1 - x0) / 2) rnd = (x1 - x0) / 2;  // caps must not overlap
+  if (rnd > (y1 - y0) / 2) rnd = (y1 - y0) / 2;
+  if (rnd < 0) rnd = 0;
+  fill(x0, y0 + rnd, x1, y1 - rnd, colour);
+  fill_arcs(x0 + rnd, y0 + rnd, x1 - rnd, y1 - rnd, rnd, colour);
+  refresh();
+  }
+
+// fill the lines of the arcs of circle() above y0 and below y1, the spans reach
+// from the arc around x0 to the arc around x1, the lines of the centers are not filled
+void EADOG::fill_arcs(int x0, int y0, int x1, int y1, int r, uint8_t colour) {
+  int x = -r, y = 0, err = 2 - 2 * r, line = 0;   // the steps of circle()
   do {
-    line(x0 + rnd - y, y0 + rnd + x, x1 - rnd + y, y0 + rnd + x, 1);
-    line(x0 + rnd + x, y1 - rnd + y, x1 - rnd - x, y1 - rnd + y, 1);
+    int a = -x, b = y;                 // pixel a columns beside and b lines above the center
+    if (b != line && a >= b) {         // first pixel of a line, the widest
+      fill(x0 - a, y0 - b, x1 + a, y0 - b, colour);
+      fill(x0 - a, y1 + b, x1 + a, y1 + b, colour);
+      }
+    line = b;
     r = err;
     if (r <= y) err += ++y * 2 + 1;
     if (r > x || err > y) err += ++x * 2 + 1;
+    if (-x != a && a > b) {            // last pixel of a column, the widest line of the mirrored octant
+      fill(x0 - b, y0 - a, x1 + b, y0 - a, colour);
+      fill(x0 - b, y1 + a, x1 + b, y1 + a, colour);
+      }
     } while (x < 0);
-  auto_update = upd;
-  if (auto_update) update();
   }
 
 void EADOG::circle(int x0, int y0, int r, uint8_t colour) {
@@ -364,23 +916,15 @@ void EADOG::circle(int x0, int y0, int r, uint8_t colour) {
     if (r <= y) err += ++y * 2 + 1;
     if (r > x || err > y) err += ++x * 2 + 1;
     } while (x < 0);
-  if (auto_update) update();
+  refresh();
   }
 
+// one horizontal span per line, the half width grows from the poles to the center
 void EADOG::fillcircle(int x0, int y0, int r, uint8_t colour) {
-  uint8_t upd;
-  upd = auto_update;
-  auto_update = 0;
-  int x = -r, y = 0, err = 2 - 2 * r;
-  do {
-    line(x0 - y, y0 + x, x0 + y, y0 + x, 1);
-    line(x0 + x, y0 + y, x0 - x, y0 + y, 1);
-    r = err;
-    if (r <= y) err += ++y * 2 + 1;
-    if (r > x || err > y) err += ++x * 2 + 1;
-    } while (x < 0);
-  auto_update = upd;
-  if (auto_update) update();
+  if (r < 0) return;
+  fill(x0 - r, y0, x0 + r, y0, colour);
+  fill_arcs(x0, y0, x0, y0, r, colour);
+  refresh();
   }
 
 void EADOG::locate(uint8_t x, uint8_t y) {
@@ -391,83 +935,395 @@ void EADOG::locate(uint8_t x, uint8_t y) {
 int EADOG::_putc(int value) {
   if (value == '\n') {    // new line
     char_x = 0;
-    char_y = char_y + font_buffer[2];
-    if (char_y >= height - font_buffer[2]) {
+    char_y = char_y + font_vert;
+    if (char_y >= height - font_vert) {
       char_y = 0;
       }
     }
-  else {
-    character(char_x, char_y, value);
-    if (auto_update) update();
+  else if (utf8(value)) {
+    character(char_x, char_y, utf8_code);
+    refresh();
     }
   return value;
   }
 
+// sparse fonts get the codepoints of UTF-8 text, other fonts the bytes
+bool EADOG::utf8(uint8_t byte) {
+  if (font_format != FONT_SPARSE || byte < 0x80) {
+    utf8_code = byte;
+    utf8_rest = 0;
+    return true;
+    }
+  if (byte < 0xC0) {                     // continuation byte
+    if (utf8_rest == 0) return false;    // stray byte is dropped
+    utf8_code = (utf8_code << 6) | (byte & 0x3F);
+    return --utf8_rest == 0 && utf8_code <= 0xFFFF;
+    }
+  utf8_rest = byte < 0xE0 ? 1 : byte < 0xF0 ? 2 : 3; // start of a sequence
+  utf8_code = byte & (0x3F >> utf8_rest);
+  return false;
+  }
+
+// printf and putc of Stream render the whole string before one update
+void EADOG::lock() {
+  batch_begin();
+  }
+
+void EADOG::unlock() {
+  batch_end();
+  }
+
+void EADOG::text(uint8_t x, uint8_t y, const char *s) {
+  Batch batch(*this);                    // one update for the string
+  locate(x, y);
+  while (*s) _putc(*s++);
+  }
+
+int EADOG::textf(uint8_t x, uint8_t y, const char *format, ...) {
+  char buffer[EADOG_TEXT_BUFFER];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  text(x, y, buffer);
+  return n;
+  }
+
+int EADOG::textWidth(const char *s) {
+  int w, h;
+  textBounds(s, w, h);
+  return w;
+  }
+
+// only the cached width table is read, lines are not wrapped at the display border
+void EADOG::textBounds(const char *s, int &w, int &h) {
+  uint32_t code = utf8_code;             // keep a sequence of printf in progress
+  uint8_t rest = utf8_rest;
+  int line = 0;
+
+  utf8_rest = 0;
+  w = 0;
+  h = *s ? font_vert : 0;
+  for (; *s; s++) {
+    if (*s == '\n') {                    // new line
+      line = 0;
+      if (s[1]) h += font_vert;
+      }
+    else if (utf8(*s)) {
+      line += char_width(utf8_code);
+      if (line > w) w = line;
+      }
+    }
+  utf8_code = code;
+  utf8_rest = rest;
+  }
+
 int EADOG::_getc() {
       return -1;
   }
 
-void EADOG::character(uint8_t x, uint8_t y, uint8_t c) {
-  unsigned int hor, vert, offset, bpl, b;
-  uint8_t *sign;
-  uint8_t z, w;
+void EADOG::character(uint8_t x, uint8_t y, uint16_t c) {
+  unsigned int hor, vert, offset, bpl;
+  const uint8_t *sign;
+  uint8_t w;
+
+  if (font_format != 0) {              // font format of this library
+    glyph(x, y, c);
+    return;
+    }
 
-  if ((c < 31) || (c > 127)) return;   // test char range
+  if ((c < 32) || (c > 127)) return;   // test char range
 
   // read font parameter from start of array
-  offset = font_buffer[0];                    // bytes / char
-  hor = font_buffer[1];                       // get hor size of font
-  vert = font_buffer[2];                      // get vert size of font
+  offset = font_stride;                       // bytes / char
+  hor = font_hor;                             // get hor size of font
+  vert = font_vert;                           // get vert size of font
   bpl = font_buffer[3];                       // bytes per line
 
+  wrap(hor, vert);
+
+  sign = &font_widths[(c - 32) * offset];     // start of char bitmap
+  w = sign[0];                          // width of actual char
+  // the font columns are bytes of 8 lines, blit them only for the actual width
+  for (unsigned int i = 0; i < w; i++) {       // horz line
+    for (unsigned int k = 0; k < bpl && k * 8 < vert; k++) { // vert bytes
+      uint8_t mask = vert - k * 8 >= 8 ? 0xFF : (1 << (vert - k * 8)) - 1;
+      blit(x + i, y + k * 8, sign[bpl * i + k + 1], mask);
+      }
+    }
+  if (w < hor) fill(x + w, y, x + hor - 1, y + vert - 1, 0); // clear the rest of the cell, a narrow glyph over a wide one
+  dirty(x, y, x + w - 1, y + vert - 1);
+  char_x += w;
+  }
+
+// next line for a char that does not fit
+void EADOG::wrap(int hor, int vert) {
   if (char_x + hor > width) {
     char_x = 0;
     char_y = char_y + vert;
-    if (char_y >= height - font_buffer[2]) {
+    if (char_y >= height - vert) {
       char_y = 0;
       }
     }
+  }
 
-  sign = &font_buffer[((c - 32) * offset) + 4]; // start of char bitmap
-  w = sign[0];                          // width of actual char
-  // construct the char into the font_graphic_buffer
-  for (unsigned int j = 0; j < vert; j++) {  //  vert line
-    for (unsigned int i = 0; i < hor; i++) {   //  horz line
-      z =  sign[bpl * i + ((j & 0xF8) >> 3) + 1];
-      b = 1 << (j & 0x07);
-      if (( z & b ) == 0x00) {
-        pixel(x+i, y+j, 0);
-        }
-      else {
-        pixel(x+i, y+j, 1);
+// draw a char of a page-native, packed or sparse font
+void EADOG::glyph(uint8_t x, uint8_t y, uint16_t c) {
+  int index = find(c);                 // position of the char in the font
+
+  if (index < 0) return;               // test char range
+  wrap(font_hor, font_vert);
+
+  uint8_t w = font_widths[index];      // width of actual char
+  if (font_format == FONT_PACKED) {
+    const uint8_t *offsets = &font_widths[font_count];
+    const uint8_t *sign = &offsets[2 * font_count + (offsets[2 * index] | (offsets[2 * index + 1] << 8))];
+    fill(x, y, x + font_hor - 1, y + font_vert - 1, 0); // background of the cell, the box holds all pixels
+    unpack(x + sign[0], y + sign[1], sign[2], sign[3], &sign[4]);
+    }
+  else {
+    copy_pages(x, y, &font_widths[font_count + index * ((font_vert + 7) / 8) * font_hor], w, font_hor, font_vert);
+    if (w < font_hor) fill(x + w, y, x + font_hor - 1, y + font_vert - 1, 0); // rest of the cell
+    }
+  char_x += w;
+  }
+
+// position of a char in the active font, -1 if the font has no such char
+int EADOG::find(uint16_t c) {
+  if (font_format == FONT_SPARSE) return lookup(c);
+  return c >= font_first && c < font_first + font_count ? c - font_first : -1;
+  }
+
+// width of a char of the active font, 0 if the font has no such char
+uint8_t EADOG::char_width(uint16_t c) {
+  int index = find(c);
+  return index < 0 ? 0 : font_widths[index * font_stride];
+  }
+
+// binary search in the sorted codepoints of a sparse font, -1 if missing
+int EADOG::lookup(uint16_t c) {
+  const uint8_t *codes = &font_buffer[6];
+  int low = 0;
+  int high = font_count - 1;
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    uint16_t code = codes[2 * mid] | (codes[2 * mid + 1] << 8);
+    if (code == c) return mid;
+    if (code < c) low = mid + 1;
+    else high = mid - 1;
+    }
+  return -1;
+  }
+
+// draw page-native data, whole pages are copied if y is page aligned,
+// else each byte is shifted over two pages
+void EADOG::copy_pages(int x, int y, const uint8_t *data, int w, int stride, int lines) {
+  int x0 = x < clip_x0 ? clip_x0 : x;  // columns inside the clip rect
+  int x1 = x + w - 1 > clip_x1 ? clip_x1 : x + w - 1;
+  if (x0 > x1 || y > clip_y1 || y + lines - 1 < clip_y0) return;
+  for (int k = 0; k * 8 < lines; k++) {
+    const uint8_t *column = &data[k * stride + x0 - x];
+    int line = y + k * 8;
+    uint8_t mask = lines - k * 8 >= 8 ? 0xFF : (1 << (lines - k * 8)) - 1;
+    if (mask == 0xFF && line >= clip_y0 && line + 7 <= clip_y1 && (line & 0x07) == 0) {
+      memcpy(buffer(x0, line / 8), column, x1 - x0 + 1); // page aligned, copy the page
+      }
+    else {
+      for (int i = 0; i <= x1 - x0; i++) blit(x0 + i, line, column[i], mask);
+      }
+    }
+  dirty(x0, y, x1, y + lines - 1);
+  }
+
+// PackBits decoder writing the page bytes of a box straight into the buffer,
+// a run or literal is split at the end of a page
+void EADOG::unpack(int x, int y, int cols, int lines, const uint8_t *data) {
+  int pages = (lines + 7) / 8;
+  int col = 0;
+  int page = 0;
+  int x0 = x < clip_x0 ? clip_x0 : x;  // columns inside the clip rect
+  int x1 = x + cols - 1 > clip_x1 ? clip_x1 : x + cols - 1;
+
+  if (x0 > x1 || y > clip_y1 || y + lines - 1 < clip_y0) return;
+  while (page < pages) {
+    uint8_t n = *data++;
+    if (n == 128) continue;            // no operation
+    bool run = n > 128;
+    int count = run ? 257 - n : n + 1; // repeat one byte or copy literal bytes
+    const uint8_t *src = data;
+    data += run ? 1 : count;
+    while (count > 0 && page < pages) {
+      int len = cols - col < count ? cols - col : count;
+      uint8_t mask = lines - page * 8 >= 8 ? 0xFF : (1 << (lines - page * 8)) - 1;
+      span(x + col, y + page * 8, src, len, run, mask);
+      if (!run) src += len;
+      count -= len;
+      col += len;
+      if (col == cols) {
+        col = 0;
+        page++;
         }
       }
     }
-  char_x += w;
+  dirty(x0, y, x1, y + lines - 1);
   }
 
+// write a run or literal bytes of one page, page aligned spans are memset / memcpy
+void EADOG::span(int x, int y, const uint8_t *src, int len, bool run, uint8_t mask) {
+  int x0 = x < clip_x0 ? clip_x0 : x;
+  int x1 = x + len - 1 > clip_x1 ? clip_x1 : x + len - 1;
+  if (x0 > x1 || y > clip_y1 || y + 7 < clip_y0) return;
+  if (mask == 0xFF && y >= clip_y0 && y + 7 <= clip_y1 && (y & 0x07) == 0) {
+    if (run) memset(buffer(x0, y / 8), *src, x1 - x0 + 1);
+    else memcpy(buffer(x0, y / 8), &src[x0 - x], x1 - x0 + 1);
+    }
+  else {
+    for (int i = x0; i <= x1; i++) blit(i, y, run ? *src : src[i - x], mask);
+    }
+  }
+
+// write the masked lines of a column byte to lines y .. y + 7,
+// shifted over two pages if y is not page aligned
+void EADOG::blit(int x, int y, uint8_t bits, uint8_t mask) {
+  if (x < clip_x0 || x > clip_x1) return;
+  if (y < clip_y0) {                   // cut lines above the clip rect
+    if (clip_y0 - y > 7) return;
+    mask &= 0xFF << (clip_y0 - y);
+    }
+  if (y + 7 > clip_y1) {               // cut lines below the clip rect
+    if (y + 7 - clip_y1 > 7) return;
+    mask &= 0xFF >> (y + 7 - clip_y1);
+    }
+  int page = y >= 0 ? y / 8 : -((7 - y) / 8); // round down for lines above the display
+  int shift = y - page * 8;
+  uint8_t m = mask << shift;
+  if (m) {
+    uint8_t *p = buffer(x, page);
+    *p = (*p & ~m) | ((bits << shift) & m);
+    }
+  if (shift) {
+    m = mask >> (8 - shift);
+    if (m) {
+      uint8_t *p = buffer(x, page + 1);
+      *p = (*p & ~m) | ((bits >> (8 - shift)) & m);
+      }
+    }
+  }
 
 void EADOG::font(uint8_t *f) {
+  font((const uint8_t *)f);
+  }
+
+// cache the metrics of the font, text and textWidth() read no header bytes
+void EADOG::font(const uint8_t *f) {
   font_buffer = f;
+  utf8_rest = 0;
+  if (f[0] != 0) {                     // GLCD Font Creator format
+    font_format = 0;
+    font_hor = f[1];
+    font_vert = f[2];
+    font_first = 32;
+    font_count = 96;
+    font_widths = &f[4];               // width is the first byte of a char
+    font_stride = f[0];
+    }
+  else {
+    font_format = f[1];
+    font_hor = f[2];
+    font_vert = f[3];
+    if (font_format == FONT_SPARSE) {
+      font_first = 0;
+      font_count = f[4] | (f[5] << 8);
+      font_widths = &f[6 + 2 * font_count];
+      }
+    else {
+      font_first = f[4];
+      font_count = f[5] - f[4] + 1;
+      font_widths = &f[6];
+      }
+    font_stride = 1;
+    }
   }
 
+// the rows are transposed in blocks of 8 x 8 pixels to column bytes
 void EADOG::bitmap(Bitmap bm, int x, int y) {
-  int b;
-  char d;
-
-  for (int v = 0; v < bm.ySize; v++) {   // lines
-    for (int h = 0; h < bm.xSize; h++) { // pixel
-      if (h + x >= width) break;
-      if (v + y >= height) break;
-      d = bm.data[bm.byte_in_Line * v + ((h & 0xF8) >> 3)];
-      b = 0x80 >> (h & 0x07);
-      if ((d & b) == 0) {
-        pixel(x+h, y+v, 0);
-        }
-      else {
-        pixel(x+h, y+v, 1);
+  const uint8_t *data = (const uint8_t *)bm.data;
+  uint8_t columns[8];
+  int x0 = x < clip_x0 ? clip_x0 : x;  // columns inside the clip rect
+  int x1 = x + bm.xSize - 1 > clip_x1 ? clip_x1 : x + bm.xSize - 1;
+
+  if (x0 > x1 || y > clip_y1 || y + bm.ySize - 1 < clip_y0) return;
+  for (int page = 0; page * 8 < bm.ySize; page++) {
+    int line = y + page * 8;
+    if (line > clip_y1 || line + 7 < clip_y0) continue;
+    uint8_t mask = bm.ySize - page * 8 >= 8 ? 0xFF : (1 << (bm.ySize - page * 8)) - 1;
+    for (int column = (x0 - x) / 8; column <= (x1 - x) / 8; column++) {
+      eadog_transpose_block(data, bm.byte_in_Line, bm.ySize, column, page, columns);
+      for (int i = 0; i < 8 && column * 8 + i < bm.xSize; i++) blit(x + column * 8 + i, line, columns[i], mask);
+      }
+    }
+  dirty(x0, y, x1, y + bm.ySize - 1);
+  refresh();
+  }
+
+void EADOG::bitmap(PageBitmap bm, int x, int y) {
+  copy_pages(x, y, bm.data, bm.xSize, bm.xSize, bm.ySize);
+  refresh();
+  }
+
+void EADOG::bitmap(PackedBitmap bm, int x, int y) {
+  unpack(x, y, bm.xSize, bm.ySize, bm.data);
+  refresh();
+  }
+
+// the bytes of the pages under the sprite are saved, not in banded rendering
+void EADOG::sprite(Sprite s, int x, int y, uint8_t mode, SaveUnder *save) {
+  int x0 = x < clip_x0 ? clip_x0 : x;  // columns inside the clip rect
+  int x1 = x + s.xSize - 1 > clip_x1 ? clip_x1 : x + s.xSize - 1;
+  int y0 = y < clip_y0 ? clip_y0 : y;
+  int y1 = y + s.ySize - 1 > clip_y1 ? clip_y1 : y + s.ySize - 1;
+  Batch batch(*this);                  // one update for restore and draw
+
+  if (save) {
+    restore(save);
+    if (x0 <= x1 && y0 <= y1 && !banded()) {
+      save->x = x0;
+      save->w = x1 - x0 + 1;
+      save->page = y0 / 8;
+      save->pages = y1 / 8 - y0 / 8 + 1;
+      for (int page = 0; page < save->pages; page++) {
+        memcpy(&save->data[page * save->w], buffer(x0, save->page + page), save->w);
         }
       }
     }
-    if (auto_update) update();
+  if (x0 > x1 || y0 > y1) return;
+  for (int k = 0; k * 8 < s.ySize; k++) {
+    int line = y + k * 8;
+    uint8_t lines = s.ySize - k * 8 >= 8 ? 0xFF : (1 << (s.ySize - k * 8)) - 1;
+    for (int i = x0; i <= x1; i++) {
+      int index = k * s.xSize + i - x;
+      uint8_t m = s.mask ? s.mask[index] & lines : lines;
+      if (mode == TRANSPARENT) m &= s.data[index];
+      if (m) blit(i, line, s.data[index], m);
+      }
+    }
+  dirty(x0, y0, x1, y1);
+  refresh();
+  }
+
+void EADOG::restore(SaveUnder *save) {
+  if (save->w == 0) return;
+  for (int page = 0; page < save->pages; page++) {
+    memcpy(buffer(save->x, save->page + page), &save->data[page * save->w], save->w);
+    }
+  dirty(save->x, save->page * 8, save->x + save->w - 1, (save->page + save->pages) * 8 - 1);
+  save->w = 0;
+  refresh();
+  }
+
+// the pages need xSize * ((ySize + 7) / 8) bytes
+PageBitmap EADOG::convert(Bitmap bm, uint8_t *pages) {
+  PageBitmap pb = {bm.xSize, bm.ySize, pages};
+  eadog_rows_to_pages((const uint8_t *)bm.data, bm.xSize, bm.ySize, bm.byte_in_Line, pages);
+  return pb;
   }
@@ -17,6 +17,48 @@
 
 #include "mbed.h"
 
+/** shadow buffer
+  *
+  * set EADOG_SHADOW to 1 to keep a copy of the last frame sent to the controller,
+  * update() then sends only the bytes that changed,
+  * costs another 528 / 1024 bytes of RAM
+  *
+  * EADOG_READDRESS_COST is the longest gap of unchanged bytes that is sent
+  * through instead of setting a new column address
+  *
+  */
+#ifndef EADOG_SHADOW
+#define EADOG_SHADOW 0
+#endif
+
+#ifndef EADOG_READDRESS_COST
+#define EADOG_READDRESS_COST 4
+#endif
+
+/** callbacks of update_async() requests coalesced into one transfer
+  *
+  */
+#ifndef EADOG_ASYNC_CALLBACKS
+#define EADOG_ASYNC_CALLBACKS 4
+#endif
+
+/** no heap
+  *
+  * set EADOG_NO_HEAP to 1 on targets without heap, only the constructor
+  * with a display buffer owned by the caller and EADOGPanel are available
+  *
+  */
+#ifndef EADOG_NO_HEAP
+#define EADOG_NO_HEAP 0
+#endif
+
+/** size of the stack buffer for textf()
+  *
+  */
+#ifndef EADOG_TEXT_BUFFER
+#define EADOG_TEXT_BUFFER 64
+#endif
+
 /** display type
   *
   * @param DOGM128 128x64 2.3''
@@ -30,9 +72,31 @@ enum {DOGM128, DOGM132, DOGL128};
   *
   * @param AUTO default
   * @param MANUELL
+  * @param DEFERRED drawing is collected and updated from an event queue with max framerate
   *
   */
-enum {MANUAL, AUTO};
+enum {MANUAL, AUTO, DEFERRED};
+
+/** font formats of this library, the first byte of these font arrays is 0,
+  * else it is the number of bytes per char of a GLCD Font Creator font
+  *
+  * @param FONT_PAGE page-native, the glyphs are stored as the pages of the display RAM,
+  * created with tools/fontconv.py
+  * @param FONT_PACKED glyphs trimmed to the box of their pixels and compressed with PackBits,
+  * created with tools/fontconv.py --format packed
+  * @param FONT_SPARSE page-native glyphs of a sorted list of Unicode codepoints,
+  * text is decoded as UTF-8, created with tools/fontconv.py --format sparse
+  *
+  */
+enum {FONT_PAGE = 1, FONT_PACKED, FONT_SPARSE};
+
+/** sprite draw modes
+  *
+  * @param OPAQUE set and clear pixels inside the mask
+  * @param TRANSPARENT only set pixels inside the mask are drawn, default
+  *
+  */
+enum {OPAQUE, TRANSPARENT};
 
 /** display settings
   *
@@ -47,6 +111,29 @@ enum {MANUAL, AUTO};
   */
 enum {ON, OFF, SLEEP, DEFAULT, INVERT, BOTTOM, TOPVIEW, CONTRAST};
 
+/** geometry of the display types, known at compile time
+  *
+  * @param width pixel columns
+  * @param height pixel lines
+  * @param size bytes of the display buffer, one byte holds 8 lines of a column
+  * @param buffer bytes for a display buffer owned by the caller, twice the size with EADOG_SHADOW
+  *
+  * unknown display types use the geometry of DOGM128
+  */
+template <uint8_t TYPE> struct EADOGGeometry {
+  static const uint8_t width = 128;      // DOGM128, DOGL128
+  static const uint8_t height = 64;
+  static const uint32_t size = 1024;
+  static const uint32_t buffer = size * (1 + EADOG_SHADOW);
+  };
+
+template <> struct EADOGGeometry<DOGM132> {
+  static const uint8_t width = 132;
+  static const uint8_t height = 32;
+  static const uint32_t size = 528;
+  static const uint32_t buffer = size * (1 + EADOG_SHADOW);
+  };
+
 /** bitmap
   *
   */
@@ -57,6 +144,52 @@ struct Bitmap {
   char *data;
   };
 
+/** page-native bitmap, stored like the display RAM
+  *
+  * the xSize column bytes of the first 8 lines, then of the next 8 lines,
+  * bit 0 is the top line of a page
+  */
+struct PageBitmap {
+  int xSize;
+  int ySize;
+  const uint8_t *data;
+  };
+
+/** PackBits compressed page-native bitmap
+  *
+  * the bytes of a PageBitmap, n < 128 is followed by n + 1 literal bytes,
+  * n > 128 by one byte repeated 257 - n times, created with tools/bitmapconv.py --packed
+  */
+struct PackedBitmap {
+  int xSize;
+  int ySize;
+  const uint8_t *data;
+  };
+
+/** sprite, page-native pixels with an optional page-native mask plane
+  *
+  * a set mask bit belongs to the sprite, mask NULL uses the whole box
+  */
+struct Sprite {
+  int xSize;
+  int ySize;
+  const uint8_t *data;
+  const uint8_t *mask;
+  };
+
+/** background saved under a sprite
+  *
+  * data needs xSize * ((ySize + 7) / 8 + 1) bytes for a sprite of xSize x ySize,
+  * start with SaveUnder bg = {buffer};
+  */
+struct SaveUnder {
+  uint8_t *data;
+  int x;                                 // first saved column
+  int w;                                 // saved columns, 0 for nothing saved
+  int page;                              // first saved page
+  int pages;
+  };
+
 /** Library for the EADOG LCD displays from electronic assembly
  *
  * Example for EA DOGM132x-5 with STM32F401RE Nucleo
@@ -151,6 +284,7 @@ class EADOG : public Stream  {
 
 public:
 
+#if !EADOG_NO_HEAP
   /** create a EADOG object connected to SPI
     *
     * @param mosi pinname
@@ -160,8 +294,31 @@ public:
     * @param cs pinname
     * @param type DOGM128, DOGM132, DOGL128
     *
+    * the display buffer is allocated on the heap
     */
   EADOG(PinName mosi, PinName sck, PinName reset, PinName a0, PinName cs, uint8_t type);
+#endif
+
+  /** create a EADOG object with a display buffer owned by the caller
+    *
+    * @param mosi pinname
+    * @param sck pinname
+    * @param reset pinname
+    * @param a0 pinname
+    * @param cs pinname
+    * @param type DOGM128, DOGM132, DOGL128
+    * @param buffer display buffer of EADOGGeometry<type>::buffer bytes,
+    * e.g. placed in a DMA capable RAM bank
+    * @param pages 0 for a buffer of the whole display, or the number of pages
+    * of 8 lines in a smaller buffer of pages * width bytes, see render()
+    *
+    */
+  EADOG(PinName mosi, PinName sck, PinName reset, PinName a0, PinName cs, uint8_t type, uint8_t *buffer, uint8_t pages = 0);
+
+  /** release the display buffer if it was allocated
+    *
+    */
+  virtual ~EADOG();
 
   /** draw a pixel in buffer at x, y black or white
     *
@@ -187,9 +344,43 @@ public:
     * @param x1,y1 end point
     * @param color 1 set pixel, 0 erase pixel
     *
+    * the line is clipped once to the clip rect,
+    * only the visible part is drawn
     */
   void line(int x0, int y0, int x1, int y1, uint8_t colour);
 
+  /** restrict all drawing to a rect
+    *
+    * @param x0,y0 top left corner
+    * @param x1,y1 down right corner
+    *
+    * the rect is limited to the display
+    */
+  void clip(int x0, int y0, int x1, int y1);
+
+  /** draw on the whole display again
+    *
+    */
+  void clip();
+
+  /** draw a horizontal line
+    *
+    * @param x0,x1 start and end column
+    * @param y line
+    * @param colour 1 set pixel, 0 erase pixel
+    *
+    */
+  void hline(int x0, int x1, int y, uint8_t colour);
+
+  /** draw a vertical line
+    *
+    * @param x column
+    * @param y0,y1 start and end line
+    * @param colour 1 set pixel, 0 erase pixel
+    *
+    */
+  void vline(int x, int y0, int y1, uint8_t colour);
+
   /** draw a rect
     *
     * @param x0,y0 top left corner
@@ -244,8 +435,8 @@ public:
     * @param r radius
     * @param color 1 set pixel, 0 erase pixel
     *
-    * use circle with different radius,
-    * can miss some pixel
+    * every line is drawn once as a horizontal span,
+    * exactly inside the pixels of circle()
     *
     */
   void fillcircle(int x, int y, int r, uint8_t colour);
@@ -254,11 +445,77 @@ public:
     *
     * @param AUTO set update mode to auto, default
     * @param MANUELL the update function must manually set
-    * update() copy display buffer to lcd
+    * @param DEFERRED drawing only schedules one update on an event queue,
+    * bursts of drawing are collected into one frame, see framerate()
+    * update() copy display buffer to lcd,
+    * only the changed columns of changed pages are sent
     */
   void update();
   void update(uint8_t mode);
 
+  /** group drawing into one update
+    *
+    * drawing inside the scope of a Batch does not update the lcd,
+    * the outermost Batch updates once at the end of its scope,
+    * batches can be nested
+    * @code
+    * {
+    *   EADOG::Batch batch(lcd);
+    *   lcd.rectangle(0, 0, 40, 20, 1);
+    *   lcd.locate(4, 4);
+    *   lcd.printf("mbed");
+    *   } // one update here
+    * @endcode
+    */
+  class Batch {
+  public:
+    Batch(EADOG &lcd);
+    ~Batch();
+  private:
+    Batch(const Batch &);
+    Batch &operator=(const Batch &);
+    EADOG &_lcd;
+    };
+
+  /** set the max framerate and the event queue for DEFERRED update mode
+    *
+    * @param fps max frames per second, default 25
+    * @param queue event queue for the updates, default the shared mbed_event_queue()
+    *
+    */
+  void framerate(uint8_t fps, EventQueue *queue = NULL);
+
+  /** update copy a window of the display buffer to lcd
+    *
+    * @param x0,y0 top left corner
+    * @param x1,y1 down right corner
+    *
+    * the window is rounded to pages of 8 lines,
+    * the changed state of the rest of the buffer is kept for update()
+    */
+  void update(int x0, int y0, int x1, int y1);
+
+#if DEVICE_SPI_ASYNCH
+  /** update copy display buffer to lcd in background with DMA
+    *
+    * @param done callback when the transfer is finished, called in interrupt context
+    * @returns false if done is dropped, more than EADOG_ASYNC_CALLBACKS requests were queued
+    *
+    * returns immediately, the pages are sent as a chain of SPI transfers,
+    * a call while a transfer is running is queued and done after it,
+    * the callbacks of all queued calls are called when their data is sent,
+    * after an SPI error they are called too and the unsent data is kept for the next update,
+    * call it from a thread or from a done callback, not from other interrupts
+    */
+  bool update_async(Callback<void()> done = Callback<void()>());
+
+  /** check for a running background update
+    *
+    * @returns true while update_async() is transferring
+    */
+  bool busy();
+#endif
+
   /** display functions
     *
     * @param display ON switch display on, or wake up from sleep
@@ -286,14 +543,37 @@ public:
     */
   void cls();
 
+  /** draw a scene and send it to the lcd
+    *
+    * @param draw callback drawing the whole scene
+    *
+    * with a buffer of the whole display the buffer is cleared, draw is called
+    * and the lcd is updated once, also in MANUAL and DEFERRED mode.
+    * with a smaller buffer of some pages the scene is drawn once per band of pages,
+    * all drawing is clipped to the band, and each band is sent before the next one,
+    * drawing outside of render() is discarded then.
+    * @code
+    * uint8_t band[128];
+    * EADOG lcd(PA_7, PA_5, PC_7, PA_9, PB_6, DOGM128, band, 1); // one page band
+    *
+    * void scene() {
+    *   lcd.rectangle(0, 0, 127, 63, 1);
+    *   lcd.text(4, 4, "mbed");
+    *   }
+    *
+    * lcd.render(scene);
+    * @endcode
+    */
+  void render(Callback<void()> draw);
+
   /** draw a character on given position out of the active font to the LCD
     *
     * @param x x-position of char (top left)
     * @param y y-position
-    * @param c char to print
+    * @param c char to print, the Unicode codepoint for a sparse font
     *
     */
-  void character(uint8_t x, uint8_t y, uint8_t c);
+  void character(uint8_t x, uint8_t y, uint16_t c);
 
   /** set top left position of char/printf
     *
@@ -303,6 +583,47 @@ public:
     */
   void locate(uint8_t x, uint8_t y);
 
+  /** draw a string on given position with one update
+    *
+    * @param x x-position of the string (top left)
+    * @param y y-position
+    * @param s string to print
+    *
+    */
+  void text(uint8_t x, uint8_t y, const char *s);
+
+  /** draw a formatted string on given position with one update
+    *
+    * @param x x-position of the string (top left)
+    * @param y y-position
+    * @param format printf format, the result is cut to EADOG_TEXT_BUFFER - 1 chars
+    * @returns length of the formatted string
+    *
+    */
+  int textf(uint8_t x, uint8_t y, const char *format, ...);
+
+  /** width of a string in the active font, without drawing it
+    *
+    * @param s string, UTF-8 for a sparse font
+    * @returns width in pixel of the widest line
+    *
+    */
+  int textWidth(const char *s);
+
+  /** size of a string in the active font, without drawing it
+    *
+    * @param s string, UTF-8 for a sparse font
+    * @param w returns the width in pixel of the widest line
+    * @param h returns the height in pixel of all lines
+    *
+    * @code
+    * int w, h;
+    * lcd.textBounds("23.5", w, h);
+    * lcd.text(127 - w, 0, "23.5"); // right aligned
+    * @endcode
+    */
+  void textBounds(const char *s, int &w, int &h);
+
   /** select the font to use
     *
     * @param f pointer to font array
@@ -320,6 +641,19 @@ public:
     */
   void font(uint8_t *f);
 
+  /** select the font to use, the font format is detected
+    *
+    * @param f pointer to font array in flash,
+    * GLCD Font Creator format, page-native or packed format from tools/fontconv.py,
+    * chars of a page-native font are copied page by page if y is a multiple of 8,
+    * packed fonts need about a third of the flash of large fonts
+    * @code
+    * #include "ArialR12x14_page.h" // python3 tools/fontconv.py Fonts/ArialR12x14.h > ArialR12x14_page.h
+    * lcd.font(ArialR12x14_page);
+    * @endcode
+    */
+  void font(const uint8_t *f);
+
   /** print bitmap to buffer
     *
     * @param bm Bitmap in flash
@@ -329,6 +663,57 @@ public:
     */
   void bitmap(Bitmap bm, int x, int y);
 
+  /** print page-native bitmap to buffer, pages are copied if y is a multiple of 8
+    *
+    * @param bm PageBitmap in flash or RAM
+    * @param x  x start
+    * @param y  y start
+    *
+    */
+  void bitmap(PageBitmap bm, int x, int y);
+
+  /** print compressed page-native bitmap to buffer, decoded while drawing
+    *
+    * @param bm PackedBitmap in flash
+    * @param x  x start
+    * @param y  y start
+    *
+    */
+  void bitmap(PackedBitmap bm, int x, int y);
+
+  /** draw a sprite, only the pages it covers are marked for update
+    *
+    * @param s Sprite
+    * @param x  x start
+    * @param y  y start
+    * @param mode TRANSPARENT (default) or OPAQUE
+    * @param save background saved before drawing, a former background is restored first
+    *
+    * @code
+    * uint8_t under[8 * 3];
+    * SaveUnder bg = {under};
+    * lcd.sprite(cursor, x, y, TRANSPARENT, &bg); // moves the cursor
+    * lcd.restore(&bg);                            // removes it
+    * @endcode
+    */
+  void sprite(Sprite s, int x, int y, uint8_t mode = TRANSPARENT, SaveUnder *save = NULL);
+
+  /** restore the background saved under a sprite
+    *
+    * @param save background saved by sprite()
+    *
+    */
+  void restore(SaveUnder *save);
+
+  /** convert a Bitmap to the page-native format
+    *
+    * @param bm Bitmap
+    * @param pages buffer for xSize * ((ySize + 7) / 8) bytes
+    * @returns PageBitmap of the buffer
+    *
+    */
+  static PageBitmap convert(Bitmap bm, uint8_t *pages);
+
   // declarations
   SPI _spi;
   DigitalOut _reset;
@@ -350,6 +735,22 @@ protected:
     */
   virtual int _getc();
 
+  /** stream class, printf and putc open a batch,
+    * the whole string is rendered before one update
+    *
+    */
+  virtual void lock();
+
+  /** stream class, close the batch of printf and putc
+    *
+    */
+  virtual void unlock();
+
+  /** set the size of the display type and clear the state
+    *
+    */
+  void geometry();
+
   /** init the DOGM132 LCD controller
     *
     */
@@ -362,6 +763,14 @@ protected:
     */
   void write_data(uint8_t data); // Write data to the LCD controller
 
+  /** write a block of data to the LCD controller with one chip select
+    *
+    * @param data pointer to data written to LCD controller
+    * @param length number of bytes
+    *
+    */
+  void write_data(const uint8_t *data, int length);
+
   /** Write a command the LCD controller
     *
     * @param cmd command to be written
@@ -369,16 +778,380 @@ protected:
     */
   void write_command(uint8_t command); // Write a command the LCD controller
 
+  /** write a block of commands to the LCD controller with one chip select
+    *
+    * @param command pointer to commands to be written
+    * @param length number of commands
+    *
+    */
+  void write_command(const uint8_t *command, int length);
+
+  /** open a batch, drawing does not update the lcd
+    *
+    */
+  void batch_begin();
+
+  /** close a batch, the outermost batch updates the lcd
+    *
+    */
+  void batch_end();
+
+  /** Cohen-Sutherland region code of a point against the clip rect
+    *
+    * @param x,y point
+    * @returns 0 inside, bits for left, right, top, bottom
+    *
+    */
+  uint8_t outcode(int x, int y);
+
+  /** fill a rect in the buffer without update
+    *
+    * @param x0,y0 top left corner
+    * @param x1,y1 down right corner, not less than x0,y0
+    * @param colour 1 set pixel, 0 erase pixel
+    *
+    */
+  void fill(int x0, int y0, int x1, int y1, uint8_t colour);
+
+  /** fill the lines of the arcs drawn by circle() without update
+    *
+    * @param x0,y0 center of the left and the upper arcs
+    * @param x1,y1 center of the right and the lower arcs
+    * @param r radius
+    * @param colour 1 set pixel, 0 erase pixel
+    *
+    * each line is filled once, exactly between the pixels of the arcs,
+    * the lines y0 and y1 are left to the caller
+    */
+  void fill_arcs(int x0, int y0, int x1, int y1, int r, uint8_t colour);
+
+  /** next line for a char that does not fit
+    *
+    * @param hor max width of the font
+    * @param vert height of the font
+    *
+    */
+  void wrap(int hor, int vert);
+
+  /** collect the bytes of UTF-8 text for a sparse font
+    *
+    * @param byte next byte of the text
+    * @returns true if utf8_code holds the next char
+    *
+    */
+  bool utf8(uint8_t byte);
+
+  /** draw a char of a font in the format of this library
+    *
+    * @param x x-position of char (top left)
+    * @param y y-position
+    * @param c char to print
+    *
+    */
+  void glyph(uint8_t x, uint8_t y, uint16_t c);
+
+  /** find a char in the active font
+    *
+    * @param c char
+    * @returns position of the char in the font, -1 if the font has no such char
+    *
+    */
+  int find(uint16_t c);
+
+  /** width of a char out of the cached width table
+    *
+    * @param c char
+    * @returns width in pixel, 0 if the font has no such char
+    *
+    */
+  uint8_t char_width(uint16_t c);
+
+  /** find a char in a sparse font
+    *
+    * @param c codepoint of the char
+    * @returns position of the char in the font, -1 if the font has no such char
+    *
+    */
+  int lookup(uint16_t c);
+
+  /** draw page-native data of a char or bitmap, without update
+    *
+    * @param x,y top left corner
+    * @param data column bytes of the first page
+    * @param w columns to draw
+    * @param stride bytes from a page to the next
+    * @param lines lines to draw
+    *
+    */
+  void copy_pages(int x, int y, const uint8_t *data, int w, int stride, int lines);
+
+  /** decode PackBits compressed page bytes of a box into the buffer
+    *
+    * @param x,y top left corner of the box
+    * @param cols columns of the box
+    * @param lines lines of the box
+    * @param data PackBits data of the page bytes, page by page
+    *
+    */
+  void unpack(int x, int y, int cols, int lines, const uint8_t *data);
+
+  /** write a run or literal bytes of one page of a box, without update
+    *
+    * @param x,y left end of the span
+    * @param src value of the run or the literal bytes
+    * @param len columns of the span
+    * @param run true for a run of *src
+    * @param mask lines of the page inside the box
+    *
+    */
+  void span(int x, int y, const uint8_t *src, int len, bool run, uint8_t mask);
+
+  /** write a column byte of 8 lines to the buffer, without update
+    *
+    * @param x column
+    * @param y first line, need not be page aligned
+    * @param bits pixel of lines y .. y + 7, bit 0 is line y
+    * @param mask lines to write, others are kept
+    *
+    * the byte is clipped to the clip rect and shifted over two pages
+    * if y is not page aligned, the caller marks the changed rect
+    */
+  void blit(int x, int y, uint8_t bits, uint8_t mask);
+
+  /** update after drawing, depending on the update mode
+    *
+    */
+  void refresh();
+
+  /** event queue context, update once for all drawing since the last frame
+    *
+    */
+  void deferred_update();
+
+  /** check for a band buffer smaller than the display
+    *
+    * @returns true if the buffer holds less than the whole display
+    *
+    */
+  bool banded();
+
+  /** set the clip rect from the rect of clip() and the band in the buffer
+    *
+    * with a band buffer the clip rect is empty outside of render(),
+    * drawing would write past the band
+    */
+  void clip_band();
+
+  /** pointer into the display buffer
+    *
+    * @param x column
+    * @param page page, inside the actual band
+    * @returns pointer to the byte of the column in the page
+    *
+    */
+  uint8_t *buffer(int x, int page) {
+    return &graphic_buffer[(page - band_page) * width + x];
+    }
+
+  /** send a column span of a page to the LCD controller
+    *
+    * @param page page address
+    * @param first first column
+    * @param last last column
+    *
+    */
+  void send(uint8_t page, uint8_t first, uint8_t last);
+
+#if EADOG_SHADOW
+  /** send the changed bytes of a column span compared to the shadow buffer
+    *
+    * @param page page address
+    * @param first first column
+    * @param last last column
+    *
+    */
+  void send_changes(uint8_t page, uint8_t first, uint8_t last);
+#endif
+
+  /** build the page and column address commands
+    *
+    * @param commands buffer for 3 commands
+    * @param page page address
+    * @param column column address
+    *
+    */
+  void address(uint8_t *commands, uint8_t page, uint8_t column);
+
+  /** mark the whole frame for the next update, with a shadow buffer every byte is sent
+    *
+    */
+  void invalidate();
+
+  /** mark a rectangle of the buffer as changed for the next update
+    *
+    * @param x0,y0 top left corner
+    * @param x1,y1 down right corner
+    *
+    * the rectangle is limited to the display
+    */
+  void dirty(int x0, int y0, int x1, int y1);
+
+  /** widen the changed column span of a page
+    *
+    * @param page page
+    * @param x0 first changed column
+    * @param x1 last changed column
+    *
+    * min and max are changed together, take_dirty() of the event queue
+    * or an interrupt never sees half of the span
+    */
+  void dirty_span(int page, int x0, int x1);
+
+  /** merge the changed column spans into first / last and clear them
+    *
+    * @param first first changed column per page
+    * @param last last changed column per page
+    *
+    */
+  void take_dirty(uint8_t *first, uint8_t *last);
+
+  /** wait until a background update is finished
+    *
+    */
+  void sync();
+
+#if DEVICE_SPI_ASYNCH
+  /** move the queued changed spans in flight and start the transfer
+    *
+    */
+  void async_start();
+
+  /** skip unchanged pages, start the next transfer or finish
+    *
+    */
+  void async_next();
+
+  /** start the SPI transfer of the actual page
+    *
+    */
+  void async_transfer();
+
+  /** SPI event handler, chains the next transfer
+    *
+    * @param event SPI event
+    *
+    */
+  void async_event(int event);
+
+  /** end of a transfer, calls its callbacks
+    *
+    */
+  void async_finish();
+
+  /** end the transfer chain after an SPI error, the unsent spans stay dirty
+    *
+    */
+  void async_abort();
+#endif
+
   // Variables
-  uint8_t *font_buffer;
+  const uint8_t *font_buffer;
+  const uint8_t *font_widths;            // width of the first char of the font
+  uint8_t font_stride;                   // bytes from one width to the next
+  uint8_t font_format;                   // 0 for GLCD Font Creator fonts
+  uint8_t font_hor;
+  uint8_t font_vert;
+  uint16_t font_first;                   // code of the first char
+  uint16_t font_count;                   // number of chars
   uint8_t char_x;
   uint8_t char_y;
+  uint32_t utf8_code;                    // codepoint of the UTF-8 sequence
+  uint8_t utf8_rest;                     // missing continuation bytes
   uint8_t auto_update;
+  bool refresh_scheduled;
+  uint8_t batch_depth;                   // nested Batch objects
+  int refresh_interval;                  // ms between DEFERRED updates
+  EventQueue *refresh_queue;
+#ifdef EADOG_FIXED_TYPE                 // DOGM128, DOGM132 or DOGL128, the geometry is a constant
+  static const uint8_t width = EADOGGeometry<EADOG_FIXED_TYPE>::width;
+  static const uint8_t height = EADOGGeometry<EADOG_FIXED_TYPE>::height;
+  static const uint32_t graphic_buffer_size = EADOGGeometry<EADOG_FIXED_TYPE>::size;
+#else
   uint8_t width;
   uint8_t height;
+  uint32_t graphic_buffer_size;
+#endif
   uint8_t _type;
   uint8_t *graphic_buffer;
-  uint32_t graphic_buffer_size;
+  bool own_buffer;                       // graphic_buffer is allocated by EADOG
+  uint8_t band_pages;                    // pages in graphic_buffer
+  uint8_t band_page;                     // first page in graphic_buffer
+#if EADOG_SHADOW
+  uint8_t *shadow_buffer;                // last frame sent to the controller
+#endif
+  PlatformMutex bus_mutex;               // A0 / CS / SPI sequences of the threads are not mixed
+  int clip_x0;                           // drawing is limited to the clip rect
+  int clip_y0;
+  int clip_x1;
+  int clip_y1;
+  int view_x0;                           // rect of clip(), limited to the band by clip_band()
+  int view_y0;
+  int view_x1;
+  int view_y1;
+  bool rendering;                        // render() draws a band
+  uint8_t dirty_min[8];                  // first changed column per page
+  uint8_t dirty_max[8];                  // last changed column per page
+#if DEVICE_SPI_ASYNCH
+  volatile bool async_busy;
+  volatile bool async_queued;
+  bool async_data;
+  uint8_t async_page;
+  uint8_t async_commands[3];
+  uint8_t async_first[8];
+  uint8_t async_last[8];
+  uint8_t async_queue_first[8];
+  uint8_t async_queue_last[8];
+  Callback<void()> async_done[EADOG_ASYNC_CALLBACKS];       // callbacks of the running transfer
+  Callback<void()> async_queue_done[EADOG_ASYNC_CALLBACKS]; // callbacks of the queued transfer
+  volatile uint8_t async_done_count;
+  volatile uint8_t async_queue_count;
+#endif
+
+  };
+
+/** display buffer storage, constructed before the EADOG base
+  *
+  */
+template <uint32_t SIZE> struct EADOGFrame {
+  uint8_t frame[SIZE];
+  };
+
+/** EADOG with the geometry of the display type fixed at compile time
+  * and the display buffer as member, no heap is used
+  *
+  * @code
+  * EADOGPanel<DOGM132> lcd(PA_7, PA_5, PC_7, PA_9, PB_6); // MOSI, SCK, Reset, A0, CS
+  * @endcode
+  */
+template <uint8_t TYPE>
+class EADOGPanel : private EADOGFrame<EADOGGeometry<TYPE>::buffer>, public EADOG {
+
+#ifdef EADOG_FIXED_TYPE
+  static_assert(EADOGGeometry<TYPE>::size == EADOGGeometry<EADOG_FIXED_TYPE>::size, "TYPE differs from EADOG_FIXED_TYPE");
+#endif
+
+public:
+
+  /** create a EADOGPanel object connected to SPI
+    *
+    * @param mosi pinname
+    * @param sck pinname
+    * @param reset pinname
+    * @param a0 pinname
+    * @param cs pinname
+    *
+    */
+  EADOGPanel(PinName mosi, PinName sck, PinName reset, PinName a0, PinName cs) : EADOG(mosi, sck, reset, a0, cs, TYPE, this->frame) {}
 
   };
 
@@ -0,0 +1,118 @@
+/* 8x8 bit transpose for the EADOG library, converts row-major bitmaps
+ * to the column bytes of the ST7565R display RAM
+ * Released under the MIT License: http://mbed.org/license/mit
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef EADOG_TRANSPOSE_H
+#define EADOG_TRANSPOSE_H
+
+#include <stdint.h>
+#include <string.h>
+
+/** transpose a block of 8 x 8 pixels
+  *
+  * @param rows first of 8 row bytes, the left pixel in bit 7
+  * @param stride bytes from a row to the next
+  * @param columns returns 8 column bytes, the top pixel in bit 0
+  *
+  * the bits are swapped in 3 steps of 1, 2 and 4 bits (SWAR),
+  * 64 bit hosts hold the block in one word, 32 bit MCUs in two
+  */
+inline void eadog_transpose(const uint8_t *rows, int stride, uint8_t *columns) {
+#if UINTPTR_MAX > 0xFFFFFFFFu
+  uint64_t x = ((uint64_t)rows[7 * stride] << 56) | ((uint64_t)rows[6 * stride] << 48) | // bottom row in the high byte
+               ((uint64_t)rows[5 * stride] << 40) | ((uint64_t)rows[4 * stride] << 32) |
+               ((uint32_t)rows[3 * stride] << 24) | (rows[2 * stride] << 16) | (rows[stride] << 8) | rows[0];
+  uint64_t t;
+  t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+  x = x ^ t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+  x = x ^ t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+  x = x ^ t ^ (t << 28);
+  columns[0] = x >> 56;
+  columns[1] = x >> 48;
+  columns[2] = x >> 40;
+  columns[3] = x >> 32;
+  columns[4] = x >> 24;
+  columns[5] = x >> 16;
+  columns[6] = x >> 8;
+  columns[7] = x;
+#else
+  uint32_t x = ((uint32_t)rows[7 * stride] << 24) | (rows[6 * stride] << 16) | (rows[5 * stride] << 8) | rows[4 * stride];
+  uint32_t y = ((uint32_t)rows[3 * stride] << 24) | (rows[2 * stride] << 16) | (rows[stride] << 8) | rows[0];
+  uint32_t t;
+  t = (x ^ (x >> 7)) & 0x00AA00AA;
+  x = x ^ t ^ (t << 7);
+  t = (y ^ (y >> 7)) & 0x00AA00AA;
+  y = y ^ t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC;
+  x = x ^ t ^ (t << 14);
+  t = (y ^ (y >> 14)) & 0x0000CCCC;
+  y = y ^ t ^ (t << 14);
+  t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+  y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+  x = t;
+  columns[0] = x >> 24;
+  columns[1] = x >> 16;
+  columns[2] = x >> 8;
+  columns[3] = x;
+  columns[4] = y >> 24;
+  columns[5] = y >> 16;
+  columns[6] = y >> 8;
+  columns[7] = y;
+#endif
+  }
+
+/** transpose the 8 x 8 block of a row-major bitmap at a byte column and page,
+  * rows below the bitmap are read as 0
+  *
+  * @param data rows of the bitmap, the left pixel in bit 7
+  * @param byte_in_Line bytes of a row
+  * @param ySize lines of the bitmap
+  * @param column byte column of the block
+  * @param page page of the block, lines 8 * page .. 8 * page + 7
+  * @param columns returns 8 column bytes
+  *
+  */
+inline void eadog_transpose_block(const uint8_t *data, int byte_in_Line, int ySize, int column, int page, uint8_t *columns) {
+  const uint8_t *rows = &data[page * 8 * byte_in_Line + column];
+  if (ySize - page * 8 >= 8) {
+    eadog_transpose(rows, byte_in_Line, columns);
+    }
+  else {                               // last page, pad the missing rows
+    uint8_t block[8] = {0};
+    for (int i = 0; i < ySize - page * 8; i++) block[i] = rows[i * byte_in_Line];
+    eadog_transpose(block, 1, columns);
+    }
+  }
+
+/** convert a row-major bitmap to page-native column bytes
+  *
+  * @param data rows of the bitmap, the left pixel in bit 7
+  * @param xSize columns
+  * @param ySize lines
+  * @param byte_in_Line bytes of a row
+  * @param pages returns xSize * ((ySize + 7) / 8) bytes
+  *
+  */
+inline void eadog_rows_to_pages(const uint8_t *data, int xSize, int ySize, int byte_in_Line, uint8_t *pages) {
+  uint8_t columns[8];
+  for (int page = 0; page * 8 < ySize; page++) {
+    for (int column = 0; column * 8 < xSize; column++) {
+      eadog_transpose_block(data, byte_in_Line, ySize, column, page, columns);
+      int n = xSize - column * 8 < 8 ? xSize - column * 8 : 8; // columns right of the bitmap are cut
+      memcpy(&pages[page * xSize + column * 8], columns, n);
+      }
+    }
+  }
+
+#endif
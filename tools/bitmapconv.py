@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Convert the data of a Bitmap of the EADOG library into the page-native
+PageBitmap format or the compressed PackedBitmap format.
+
+A Bitmap stores the lines from top to bottom, each line as bytes of 8
+pixels, the left pixel in the high bit. A PageBitmap stores the bytes in
+the order of the ST7565R display RAM, the column bytes of the first 8
+lines, then of the next 8 lines, bit 0 is the top line. bitmap() copies
+the pages with memcpy if y is a multiple of 8.
+
+A PackedBitmap holds the bytes of a PageBitmap compressed with PackBits,
+a mostly white logo needs a few hundred bytes instead of 1024.
+
+usage: bitmapconv.py logo.h --width 128 --height 64 [--packed] [--name logo_page] > logo_page.h
+"""
+
+import argparse
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from fontconv import packbits, read_font  # noqa: E402
+
+
+def page_bitmap(values, width, height, byte_in_line):
+    """convert the row-major bytes of a Bitmap to pages"""
+    if len(values) < byte_in_line * height:
+        sys.exit("bitmap has %d bytes, %d needed" % (len(values), byte_in_line * height))
+    out = []
+    for page in range((height + 7) // 8):
+        for x in range(width):
+            byte = 0
+            for bit in range(8):
+                y = page * 8 + bit
+                if y < height and values[y * byte_in_line + (x >> 3)] & (0x80 >> (x & 7)):
+                    byte |= 1 << bit
+            out.append(byte)
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("header", help="C header with the data array of the Bitmap")
+    parser.add_argument("--width", type=int, required=True, help="xSize of the Bitmap")
+    parser.add_argument("--height", type=int, required=True, help="ySize of the Bitmap")
+    parser.add_argument("--bytes", type=int, help="byte_in_Line of the Bitmap, default (width + 7) / 8")
+    parser.add_argument("--packed", action="store_true", help="compress the pages with PackBits")
+    parser.add_argument("--name", help="name of the new array, default <bitmap>_page or <bitmap>_packed")
+    args = parser.parse_args()
+    name, values = read_font(args.header)
+    data = page_bitmap(values, args.width, args.height, args.bytes or (args.width + 7) // 8)
+    kind = "page-native"
+    if args.packed:
+        data = packbits(data)
+        kind = "packed"
+    name = args.name or name + ("_packed" if args.packed else "_page")
+    lines = ["// %s bitmap %dx%d converted from %s by tools/bitmapconv.py" % (kind, args.width, args.height, args.header), ""]
+    lines.append("#ifndef %s_H" % name.upper())
+    lines.append("#define %s_H" % name.upper())
+    lines.append("")
+    lines.append("const unsigned char %s[] = {" % name)
+    rows = [data[page:page + args.width] for page in range(0, len(data), args.width)] if not args.packed else [data]
+    for row in rows:
+        for i in range(0, len(row), 16):
+            lines.append("        " + ", ".join("0x%02X" % v for v in row[i:i + 16]) + ",")
+    lines.append("        };")
+    lines.append("")
+    lines.append("#endif")
+    sys.stdout.write("\n".join(lines) + "\n")
+
+
+if __name__ == "__main__":
+    main()
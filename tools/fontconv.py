@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+"""Convert a GLCD Font Creator font header of the EADOG library into the
+page-native, the packed or the sparse font format.
+
+The GLCD format stores each glyph as a width byte followed by the columns,
+each column as bytes of 8 lines. The page-native format stores the glyphs
+in the order of the ST7565R display RAM, all columns of the first page,
+then all columns of the next page, so character() can copy whole pages.
+
+    0, FONT_PAGE, hor, vert, first, last,
+    width of each char first .. last,
+    pages * hor bytes per char, page by page
+
+The packed format trims each glyph to the bounding box of its pixels and
+compresses the page bytes of the box with PackBits, an index of 16 bit
+offsets gives direct access to each glyph.
+
+    0, FONT_PACKED, hor, vert, first, last,
+    width of each char first .. last,
+    offset of each glyph record from the first record, low byte first,
+    per glyph: left, top, columns, lines of the box, PackBits data
+
+The sparse format holds page-native glyphs of any Unicode codepoints up to
+0xFFFF, sorted for a binary search. The chars can be picked from the font
+and merged with the chars of more fonts, e.g. a GLCD font exported for the
+Latin-1 codes 176 .. 181 gives the degree sign and micro sign.
+
+    0, FONT_SPARSE, hor, vert, number of chars, low byte first,
+    codepoint of each char, low byte first,
+    width of each char,
+    pages * hor bytes per char, page by page
+
+usage: fontconv.py Fonts/ArialR12x14.h [--format packed] [--name ArialR12x14_packed] > ArialR12x14_packed.h
+       fontconv.py Fonts/Arial12x12.h --format sparse --chars " 0123456789.-" --add Symbols.h@176 > Arial12x12_sparse.h
+"""
+
+import argparse
+import re
+import sys
+
+FONT_PAGE = 1
+FONT_PACKED = 2
+FONT_SPARSE = 3
+
+
+def read_font(path):
+    """return array name and the numbers of the first font array in a header"""
+    text = open(path, encoding="latin-1").read()
+    text = re.sub(r"//[^\n]*", "", text)
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    match = re.search(r"(\w+)\s*\[\s*\]\s*=\s*\{(.*?)\}", text, re.S)
+    if not match:
+        sys.exit("%s: no font array found" % path)
+    values = [int(v, 0) for v in re.findall(r"0[xX][0-9a-fA-F]+|\d+", match.group(2))]
+    return match.group(1), values
+
+
+def glyphs(values, first):
+    """yield code, width and columns of each glyph of a GLCD font,
+    a column is the list of its vertical bytes"""
+    offset, hor, vert, bpl = values[:4]
+    data = values[4:]
+    for index in range(len(data) // offset):
+        record = data[index * offset:(index + 1) * offset]
+        columns = [record[1 + i * bpl:1 + (i + 1) * bpl] for i in range(hor)]
+        yield first + index, record[0], columns
+
+
+def pages_of(columns, hor, vert):
+    """return the bytes of a glyph page by page, hor columns each"""
+    columns = columns + [[]] * (hor - len(columns))
+    data = []
+    for page in range((vert + 7) // 8):
+        for column in columns:
+            byte = column[page] if page < len(column) else 0
+            if vert - page * 8 < 8:
+                byte &= (1 << (vert - page * 8)) - 1  # lines below the font
+            data.append(byte)
+    return data
+
+
+def page_font(values, first):
+    """convert the numbers of a GLCD font to the page-native format"""
+    offset, hor, vert, bpl = values[:4]
+    chars = list(glyphs(values, first))
+    last = chars[-1][0]
+    out = [[0, FONT_PAGE, hor, vert, first, last], [w for _, w, _ in chars]]
+    for code, width, columns in chars:
+        out.append((code, pages_of(columns, hor, vert)))
+    return out
+
+
+def sparse_font(fonts, chars):
+    """convert the chars of GLCD fonts to the sparse format, fonts is a list
+    of the numbers and the first code of each font, the first font wins
+    for a code in more fonts, chars is a string of the chars to keep or None"""
+    hor = max(values[1] for values, _ in fonts)
+    vert = max(values[2] for values, _ in fonts)
+    picked = {}
+    for values, first in fonts:
+        for code, width, columns in glyphs(values, first):
+            if code not in picked and (chars is None or chr(code) in chars):
+                picked[code] = (width, columns)
+    if chars is not None:
+        missing = "".join(c for c in chars if ord(c) not in picked)
+        if missing:
+            sys.exit("chars not in the fonts: %r" % missing)
+    codes = sorted(picked)
+    if codes and codes[-1] > 0xFFFF:
+        sys.exit("codepoints above 0xFFFF are not supported")
+    header = [0, FONT_SPARSE, hor, vert, len(codes) & 0xFF, len(codes) >> 8]
+    table = [b for code in codes for b in (code & 0xFF, code >> 8)] + [picked[code][0] for code in codes]
+    return [header, table] + [(code, pages_of(picked[code][1], hor, vert)) for code in codes]
+
+
+def packbits(data):
+    """PackBits, n < 128 is followed by n + 1 literal bytes,
+    n > 128 by one byte repeated 257 - n times"""
+    out = []
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and run < 128 and data[i + run] == data[i]:
+            run += 1
+        if run > 1:
+            out += [257 - run, data[i]]
+            i += run
+            continue
+        start = i
+        while i < len(data) and i - start < 128:
+            if i + 1 < len(data) and data[i + 1] == data[i]:
+                break
+            i += 1
+        out += [i - start - 1] + data[start:i]
+    return out
+
+
+def packed_font(values, first):
+    """convert the numbers of a GLCD font to the packed format"""
+    offset, hor, vert, bpl = values[:4]
+    chars = list(glyphs(values, first))
+    last = chars[-1][0]
+    records = []
+    for code, width, columns in chars:
+        def pixel(x, y):
+            return (columns[x][y >> 3] >> (y & 7)) & 1
+        points = [(x, y) for x in range(width) for y in range(vert) if pixel(x, y)]
+        if not points:
+            records.append((code, [0, 0, 0, 0]))
+            continue
+        left = min(x for x, _ in points)
+        top = min(y for _, y in points)
+        cols = max(x for x, _ in points) - left + 1
+        rows = max(y for _, y in points) - top + 1
+        data = []
+        for page in range((rows + 7) // 8):
+            for x in range(left, left + cols):
+                byte = 0
+                for bit in range(8):
+                    y = top + page * 8 + bit
+                    if page * 8 + bit < rows and pixel(x, y):
+                        byte |= 1 << bit
+                data.append(byte)
+        records.append((code, [left, top, cols, rows] + packbits(data)))
+    index = []
+    position = 0
+    for _, record in records:
+        index += [position & 0xFF, position >> 8]
+        position += len(record)
+    if position > 0xFFFF:
+        sys.exit("font too big for 16 bit offsets")
+    return [[0, FONT_PACKED, hor, vert, first, last], [w for _, w, _ in chars] + index] + records
+
+
+def write_font(name, source, out):
+    """print the converted font as C header"""
+    guard = name.upper() + "_H"
+    kind = {FONT_PAGE: "page-native", FONT_PACKED: "packed", FONT_SPARSE: "sparse"}[out[0][1]]
+    lines = ["// %s font converted from %s by tools/fontconv.py" % (kind, source), ""]
+    lines.append("#ifndef %s" % guard)
+    lines.append("#define %s" % guard)
+    lines.append("")
+    lines.append("const unsigned char %s[] = {" % name)
+    lines.append("        " + ",".join(str(v) for v in out[0]) + ",  // format, horz, vert, " + ("number of chars" if kind == "sparse" else "first, last"))
+    lines.append("        " + ", ".join("0x%02X" % v for v in out[1]) + ",  // " + {"page-native": "widths", "packed": "widths, index", "sparse": "codepoints, widths"}[kind])
+    for code, data in out[2:]:
+        char = chr(code) if code > 32 and code != 127 and chr(code) != "\\" and chr(code).isprintable() else ""
+        lines.append("        " + ", ".join("0x%02X" % v for v in data) + ",  // Code for char " + char)
+    lines.append("        };")
+    lines.append("")
+    lines.append("#endif")
+    sys.stdout.write("\n".join(lines) + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("header", help="GLCD Font Creator font header")
+    parser.add_argument("--format", choices=["page", "packed", "sparse"], default="page", help="font format, default page")
+    parser.add_argument("--name", help="name of the new array, default <font>_<format>")
+    parser.add_argument("--first", type=lambda v: int(v, 0), default=32, help="code of the first char in the font, default 32")
+    parser.add_argument("--chars", help="sparse format: chars to keep, default all chars of the fonts")
+    parser.add_argument("--add", action="append", default=[], metavar="HEADER[@FIRST]",
+                        help="sparse format: merge the chars of another font, FIRST is its first code, default 32")
+    args = parser.parse_args()
+    name, values = read_font(args.header)
+    if args.format == "sparse":
+        fonts = [(values, args.first)]
+        for spec in args.add:
+            path, _, first = spec.partition("@")
+            fonts.append((read_font(path)[1], int(first, 0) if first else 32))
+        out = sparse_font(fonts, args.chars)
+    elif args.add or args.chars:
+        sys.exit("--chars and --add need --format sparse")
+    else:
+        out = (page_font if args.format == "page" else packed_font)(values, args.first)
+    write_font(args.name or name + "_" + args.format, args.header, out)
+
+
+if __name__ == "__main__":
+    main()
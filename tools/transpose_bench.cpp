@@ -0,0 +1,60 @@
+// host benchmark of the row-major to page conversion of the EADOG library,
+// compares the 8x8 bit transpose with the per-pixel loop of bitmap()
+//
+// g++ -O2 -I.. transpose_bench.cpp -o transpose_bench && ./transpose_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "EADOGTranspose.h"
+
+#define WIDTH 128          // DOGM128 / DOGL128
+#define HEIGHT 64
+#define ROUNDS 20000
+
+static uint8_t rows[HEIGHT * WIDTH / 8];
+static uint8_t pages[WIDTH * HEIGHT / 8];
+static uint8_t reference[WIDTH * HEIGHT / 8];
+
+// the loop of bitmap() before the transpose, pixel() without the clip test
+static void per_pixel(const uint8_t *data, int xSize, int ySize, int byte_in_Line, uint8_t *out) {
+  for (int v = 0; v < ySize; v++) {      // lines
+    for (int h = 0; h < xSize; h++) {    // pixel
+      uint8_t d = data[byte_in_Line * v + ((h & 0xF8) >> 3)];
+      uint8_t b = 0x80 >> (h & 0x07);
+      if ((d & b) == 0) out[(v >> 3) * xSize + h] &= ~(1 << (v & 0x07));
+      else out[(v >> 3) * xSize + h] |= 1 << (v & 0x07);
+      }
+    }
+  }
+
+template<typename F>
+static double measure(F convert) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < ROUNDS; i++) {
+    rows[i % sizeof(rows)] ^= 1;         // keep the compiler from hoisting the work
+    convert();
+    }
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(stop - start).count() / ROUNDS;
+  }
+
+int main() {
+  for (unsigned int i = 0; i < sizeof(rows); i++) rows[i] = rand();
+
+  per_pixel(rows, WIDTH, HEIGHT, WIDTH / 8, reference);
+  eadog_rows_to_pages(rows, WIDTH, HEIGHT, WIDTH / 8, pages);
+  if (memcmp(reference, pages, sizeof(pages))) {
+    printf("transpose differs from the per-pixel loop\n");
+    return 1;
+    }
+
+  double pixel = measure([] { per_pixel(rows, WIDTH, HEIGHT, WIDTH / 8, reference); });
+  double transpose = measure([] { eadog_rows_to_pages(rows, WIDTH, HEIGHT, WIDTH / 8, pages); });
+  printf("%dx%d bitmap, %d rounds\n", WIDTH, HEIGHT, ROUNDS);
+  printf("per pixel   %8.2f us\n", pixel);
+  printf("transpose   %8.2f us\n", transpose);
+  printf("speedup     %8.1f x\n", pixel / transpose);
+  return 0;
+  }